@@ -1,39 +1,58 @@
 #pragma once
 
 #include <stl_ext.h>
+#include <task_trace.h>
 #include <threadsafe_deque.h>
+#include <work_stealing_deque.h>
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <cstdint>
+#include <deque>
 #include <functional>
 #include <future>
 #include <iostream>
 #include <list>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
 #include <utility>
+#include <vector>
+
+class ThreadPool;
 
 class ExecutionState {
 public:
-    ExecutionState(std::condition_variable* cv, std::mutex* mtx) : cv(cv), mtx(mtx) {}
+    ExecutionState(ThreadPool* pool, std::atomic<int>* finishedCount) : pool(pool), finishedCount(finishedCount) {}
 
     bool isFinished() const {
         return finished;
     }
-    void setFinshed() {
-        std::lock_guard<std::mutex> lck(*mtx);
-        finished = true;
-        cv->notify_all();
-    }
+    void setFinshed();
 
 private:
     std::atomic<bool> finished{false};
-    std::condition_variable* cv;
-    std::mutex* mtx;
+    ThreadPool* pool;
+    std::atomic<int>* finishedCount;
+};
+
+// Unit of work for the ThreadPool. The pool doesn't take ownership, execute() has to clean up after itself if needed.
+class PoolJob {
+public:
+    virtual void execute() = 0;
+
+protected:
+    ~PoolJob() = default;
 };
 
+// Work stealing thread pool. Every worker owns a lock-free deque: jobs posted from a worker go into its own deque and
+// are taken from there in LIFO order, idle workers steal the oldest jobs of the others. Jobs posted from threads that
+// don't belong to the pool go through a small shared injection queue. Urgent jobs bypass all of that, every worker
+// takes them first. Idle workers spin for a while before they park. The destructor executes all jobs that are still
+// queued and joins the workers.
 class ThreadPool {
 public:
     // If num_threads isn't set (or set to 0), number of threads is determined by hardware concurrency.
@@ -46,85 +65,643 @@ public:
                 exit(-4);
             }
         }
+        for (uint32_t i = 0; i < num_threads; i++)
+            queues.push_back(std::make_unique<WorkStealingDeque<PoolJob>>());
         for (uint32_t i = 0; i < num_threads; i++) {
-            launch_named_thread(name + "_" + std::to_string(i), low_prio, [this]() {
-                while (true)
-                    tasks.pop_front()();
-            }).detach();
+            threads.push_back(launch_named_thread(name + "_" + std::to_string(i), low_prio,
+                                                  [this, i]() { workerLoop(static_cast<int>(i)); }));
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lck(parkMtx);
+            stop = true;
         }
+        parkCv.notify_all();
+        for (auto& thread : threads)
+            thread.join();
     }
 
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool(ThreadPool&&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ThreadPool& operator=(ThreadPool&&) = delete;
+
     template <typename T>
     std::shared_ptr<std::packaged_task<T()>> run(std::function<T()> f) {
         std::shared_ptr<std::packaged_task<T()>> task(new std::packaged_task<T()>(f));
-        tasks.push_back(std::packaged_task<void()>([task]() { (*task)(); }));
+        post([task]() { (*task)(); });
         return task;
     }
 
     template <typename T>
     std::shared_ptr<std::packaged_task<T()>> run(std::function<T()> f, ExecutionState* state) {
         std::shared_ptr<std::packaged_task<T()>> task(new std::packaged_task<T()>(f));
-        tasks.push_back(std::packaged_task<void()>([task, state]() {
+        post([task, state]() {
             (*task)();
             state->setFinshed();
-        }));
+        });
         return task;
     }
 
+    // Fire and forget, there is no future to wait for.
+    void post(std::function<void()> f) {
+        post(new FunctionJob(std::move(f)));
+    }
+
+    // Doesn't allocate, the job has to stay alive until it was executed.
+    void post(PoolJob* job, bool urgent = false) {
+        if (urgent)
+            urgentJobs.push(job);
+        else if (currentPool != this || !queues[currentWorker]->push(job))
+            injectedJobs.push(job);
+        wakeWorker();
+    }
+
+    // Whether post() from the calling thread goes into its own deque. The owner takes the newest job of its deque
+    // first, the shared queues and the thieves take the oldest one.
+    bool postsToOwnDeque(bool urgent = false) const {
+        return !urgent && currentPool == this;
+    }
+
+    // Long running chains of non-urgent work should give way when this is true.
+    bool hasUrgentWork() const {
+        return !urgentJobs.empty();
+    }
+
+    // Executes pending jobs on the calling thread until done() returns true. This is what every thread that waits for
+    // pool work should do instead of blocking: it makes nested parallel sections safe (a worker waiting for its own
+    // subtasks runs them itself) and doesn't need extra threads. The jobs don't necessarily belong to the caller.
+    // Whoever makes done() true has to call notifyWaiting() afterwards.
+    template <typename Predicate>
+    void waitUntil(Predicate done) {
+        const int self = currentPool == this ? currentWorker : -1;
+        while (!done()) {
+            PoolJob* job = findJob(self);
+            for (int i = 0; job == nullptr && i < spinIterations && !done(); i++) {
+                cpuRelax();
+                job = findJob(self);
+            }
+            if (job != nullptr) {
+                job->execute();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lck(parkMtx);
+            parked.fetch_add(1, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!done() && !hasWork())
+                parkCv.wait(lck);
+            parked.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    void notifyWaiting() {
+        std::lock_guard<std::mutex> lck(parkMtx);
+        parkCv.notify_all();
+    }
+
+    size_t size() const {
+        return threads.size();
+    }
+
+    // Index of the calling worker in its pool, -1 if the caller isn't a pool thread.
+    static int workerIndex() {
+        return currentWorker;
+    }
+
 private:
-    ThreadSafeDeque<std::packaged_task<void()>> tasks;
+    class FunctionJob final : public PoolJob {
+    public:
+        explicit FunctionJob(std::function<void()> f) : f(std::move(f)) {}
+        void execute() override {
+            f();
+            delete this;
+        }
+
+    private:
+        std::function<void()> f;
+    };
+
+    // Shared queue for jobs that can't go into a worker deque. It is a ring buffer that only grows, it doesn't allocate
+    // once it is big enough.
+    class InjectionQueue {
+    public:
+        void push(PoolJob* job) {
+            std::lock_guard<std::mutex> lck(mtx);
+            if (size == ring.size()) {
+                std::vector<PoolJob*> grown(std::max<size_t>(64, ring.size() * 2));
+                for (size_t i = 0; i < size; i++)
+                    grown[i] = ring[(head + i) % ring.size()];
+                ring.swap(grown);
+                head = 0;
+            }
+            ring[(head + size) % ring.size()] = job;
+            size++;
+            count.store(size, std::memory_order_release);
+        }
+
+        PoolJob* pop() {
+            if (empty())
+                return nullptr;
+            std::lock_guard<std::mutex> lck(mtx);
+            if (size == 0)
+                return nullptr;
+            PoolJob* job = ring[head];
+            head = (head + 1) % ring.size();
+            size--;
+            count.store(size, std::memory_order_release);
+            return job;
+        }
+
+        bool empty() const {
+            return count.load(std::memory_order_acquire) == 0;
+        }
+
+    private:
+        std::mutex mtx;
+        std::vector<PoolJob*> ring;
+        size_t head = 0;
+        size_t size = 0;
+        std::atomic<size_t> count{0};
+    };
+
+    static constexpr int spinIterations = 1024;
+
+    static void cpuRelax() {
+#if defined(__i386__) || defined(__x86_64__)
+        __builtin_ia32_pause();
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    void workerLoop(int self) {
+        currentPool = this;
+        currentWorker = self;
+        while (true) {
+            PoolJob* job = findJob(self);
+            for (int i = 0; job == nullptr && i < spinIterations; i++) {
+                cpuRelax();
+                job = findJob(self);
+            }
+            if (job != nullptr) {
+                job->execute();
+                continue;
+            }
+
+            // Announce that we are going to sleep before checking for work a last time, post() checks the other way
+            // round. Either we see the job or the poster sees us and notifies while we wait.
+            std::unique_lock<std::mutex> lck(parkMtx);
+            parked.fetch_add(1, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            const bool work = hasWork();
+            if (!work && stop) {
+                parked.fetch_sub(1, std::memory_order_relaxed);
+                break;
+            }
+            if (!work)
+                parkCv.wait(lck);
+            parked.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    PoolJob* findJob(int self) {
+        PoolJob* job = urgentJobs.pop();
+        if (job == nullptr && self >= 0)
+            job = queues[self]->pop();
+        if (job == nullptr)
+            job = injectedJobs.pop();
+        const int n = static_cast<int>(queues.size());
+        for (int i = 1; job == nullptr && i <= n; i++) {
+            const int victim = (self + i) % n;
+            if (victim != self)
+                job = queues[victim]->steal();
+        }
+        return job;
+    }
+
+    bool hasWork() const {
+        if (!urgentJobs.empty() || !injectedJobs.empty())
+            return true;
+        for (const auto& queue : queues)
+            if (!queue->empty())
+                return true;
+        return false;
+    }
+
+    void wakeWorker() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (parked.load(std::memory_order_seq_cst) > 0) {
+            std::lock_guard<std::mutex> lck(parkMtx);
+            parkCv.notify_one();
+        }
+    }
+
+    static inline thread_local ThreadPool* currentPool = nullptr;
+    static inline thread_local int currentWorker = -1;
+
+    std::vector<std::unique_ptr<WorkStealingDeque<PoolJob>>> queues;
+    std::vector<std::thread> threads;
+
+    InjectionQueue injectedJobs;
+    InjectionQueue urgentJobs;
+
+    std::mutex parkMtx;
+    std::condition_variable parkCv;
+    std::atomic<int> parked{0};
+    bool stop = false;
 };
 
+inline void ExecutionState::setFinshed() {
+    // The state and its scheduler may be gone as soon as the counter changed.
+    ThreadPool* p = pool;
+    finished = true;
+    finishedCount->fetch_add(1, std::memory_order_acq_rel);
+    p->notifyWaiting();
+}
+
 class TaskScheduler {
 public:
     TaskScheduler(ThreadPool* pool) : pool(pool) {}
 
-    ExecutionState* addTask(std::function<void()> task, std::vector<ExecutionState*> dependencies) {
+    ExecutionState* addTask(std::function<void()> task, std::vector<ExecutionState*> dependencies,
+                            const char* name = "task") {
         std::lock_guard<std::mutex> lck(mtx);
-        states.emplace_back(&cv, &mtx);
-        tasks_to_schedule.emplace_back(task, &states.back(), dependencies);
+        states.emplace_back(pool, &finishedCount);
+        tasks_to_schedule.emplace_back(task, &states.back(), dependencies, name);
         return &states.back();
     }
+
+    // Records every task of the following runs into the trace, one frame per run.
+    void setTrace(TaskTrace* trace, const char* group = "") {
+        this->trace = trace;
+        traceGroup = group;
+    }
+
+    // The calling thread executes pool jobs while it waits, see ThreadPool::waitUntil.
     void run() {
+        if (trace != nullptr)
+            traceFrame = trace->beginFrame();
         while (true) {
-            std::unique_lock<std::mutex> lck(mtx);
-            bool ran_task = false;
-            for (auto it = tasks_to_schedule.begin(); it != tasks_to_schedule.end();) {
-                if (depsFinished(std::get<2>(*it))) {
-                    pool->run(std::get<0>(*it), std::get<1>(*it));
-                    ran_task = true;
-                    it = tasks_to_schedule.erase(it);
-                } else {
-                    it++;
+            const int finishedBefore = finishedCount.load(std::memory_order_acquire);
+            {
+                std::lock_guard<std::mutex> lck(mtx);
+                for (auto it = tasks_to_schedule.begin(); it != tasks_to_schedule.end();) {
+                    if (depsFinished(std::get<2>(*it))) {
+                        launch(std::get<0>(*it), std::get<1>(*it), std::get<3>(*it));
+                        it = tasks_to_schedule.erase(it);
+                    } else {
+                        it++;
+                    }
                 }
+                if (allTasksFinished())
+                    break;
             }
-            if (ran_task)
-                continue;
-            if (allTasksFinished())
-                break;
-            cv.wait(lck);
+            pool->waitUntil([this, finishedBefore]() {
+                return finishedCount.load(std::memory_order_acquire) != finishedBefore;
+            });
         }
     }
 
 private:
+    void launch(const std::function<void()>& task, ExecutionState* state, const char* name) {
+        if (trace == nullptr) {
+            pool->run(task, state);
+            return;
+        }
+        // The scheduler outlives its tasks, run() waits for all of them.
+        const int64_t readyUs = trace->nowUs();
+        pool->run(std::function<void()>([this, task, name, readyUs]() {
+                      const int64_t startUs = trace->nowUs();
+                      task();
+                      trace->record({name, traceGroup, traceFrame, readyUs, startUs, trace->nowUs(),
+                                     ThreadPool::workerIndex()});
+                  }),
+                  state);
+    }
+
     static bool depsFinished(const std::vector<ExecutionState*>& deps) {
         for (const auto& dep : deps)
             if (!dep->isFinished())
                 return false;
         return true;
     }
+    // Counts instead of checking the states: a state is only done with the scheduler after the counter was increased.
     bool allTasksFinished() const {
-        for (const auto& state : states)
-            if (!state.isFinished())
-                return false;
-        return true;
+        return finishedCount.load(std::memory_order_acquire) == static_cast<int>(states.size());
     }
 
     ThreadPool* pool;
-    std::condition_variable cv;
     std::mutex mtx;
+    std::atomic<int> finishedCount{0};
     std::list<ExecutionState> states;
-    std::list<std::tuple<std::function<void()>, ExecutionState*, std::vector<ExecutionState*>>> tasks_to_schedule;
+    std::list<std::tuple<std::function<void()>, ExecutionState*, std::vector<ExecutionState*>, const char*>>
+            tasks_to_schedule;
+    TaskTrace* trace = nullptr;
+    const char* traceGroup = "";
+    uint64_t traceFrame = 0;
+};
+
+// TaskGraph is the precompiled counterpart of TaskScheduler. The tasks and their dependencies are added once (e.g. in
+// a constructor) and the graph can then be executed as often as needed with run(). Executing the graph doesn't
+// allocate anything and nothing is rescanned: every task has an atomic counter of unfinished dependencies and the
+// thread that finishes a task launches the successors that became ready. The first of them is executed directly by
+// that thread (as a continuation), all others are posted to the pool. The nodes are posted as PoolJobs directly.
+// Dependencies have to be added before the tasks that depend on them and run() must not be called concurrently.
+//
+// Ready tasks are dispatched by priority instead of insertion order. Every task measures its runtime (exponential
+// moving average) and its rank is the length of the longest path from its start to the end of the graph (upward
+// rank as in HEFT). Roots and successors are launched in descending rank order and the continuation is the successor
+// with the highest rank, so long chains start before short leaf tasks.
+class TaskGraph {
+public:
+    using Task = size_t;
+
+    // Required tasks always run. The others are skipped if they (including what depends on them) are expected to end
+    // after the deadline of their priority, or if a task they depend on was skipped. A task that was skipped
+    // maxSkippedRuns times in a row runs anyway, so its results don't get too old.
+    enum class Priority { REQUIRED, IMPORTANT, OPTIONAL };
+
+    explicit TaskGraph(ThreadPool* pool) : pool(pool) {}
+    TaskGraph(const TaskGraph&) = delete;
+    TaskGraph(TaskGraph&&) = delete;
+    TaskGraph& operator=(const TaskGraph&) = delete;
+    TaskGraph& operator=(TaskGraph&&) = delete;
+
+    Task addTask(std::function<void()> task, const std::vector<Task>& dependencies,
+                 Priority priority = Priority::REQUIRED, const char* name = "task") {
+        nodes.emplace_back(this, nodes.size(), std::move(task), priority, name);
+        Node* node = &nodes.back();
+        node->dependencies = dependencies.size();
+        for (Task dep : dependencies) {
+            nodes.at(dep).successors.push_back(node);
+            nodes.at(dep).readySuccessors.reserve(nodes.at(dep).successors.size());
+        }
+        if (dependencies.empty())
+            roots.push_back(node);
+        return nodes.size() - 1;
+    }
+
+    // A gate is a task without work that, in addition to its dependencies, waits for openGate() in every run. It makes
+    // tasks of this graph wait for something outside of it.
+    Task addGate(const std::vector<Task>& dependencies) {
+        Task gate = addTask(nullptr, dependencies, Priority::REQUIRED, "gate");
+        Node* node = &nodes[gate];
+        node->dependencies++;
+        if (dependencies.empty())
+            roots.erase(std::find(roots.begin(), roots.end(), node));
+        return gate;
+    }
+
+    // Executes every task once and returns when all of them are finished. The calling thread helps executing them (and
+    // other pool jobs) in the meantime, so it is fine to run a graph from inside a pool task.
+    void run() {
+        start();
+        wait();
+    }
+
+    // Launches the roots and returns immediately. The graph must not be running.
+    void start() {
+        for (Node& node : nodes) {
+            node.pending.store(node.dependencies, std::memory_order_relaxed);
+            node.inputSkipped.store(false, std::memory_order_relaxed);
+        }
+        unfinished.store(nodes.size(), std::memory_order_relaxed);
+        if (trace != nullptr)
+            traceFrame = trace->beginFrame();
+        running.store(true, std::memory_order_release);
+        if (nodes.empty()) {
+            finish();
+            return;
+        }
+        launchInRankOrder(roots);
+    }
+
+    // Has to be called exactly once per run, after start().
+    void openGate(Task gate) {
+        Node* node = &nodes.at(gate);
+        if (node->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            launch(node);
+    }
+
+    void wait() {
+        pool->waitUntil([this]() { return !isRunning(); });
+    }
+
+    bool isRunning() const {
+        return running.load(std::memory_order_acquire);
+    }
+
+    // Called by the thread that finished the last task of a run, before the graph counts as not running anymore.
+    void setFinishedCallback(std::function<void()> callback) {
+        finishedCallback = std::move(callback);
+    }
+
+    // Only call these while the graph isn't running. A deadline alone is enough: a task skipped in the last
+    // maxSkippedRuns runs (defaultMaxSkippedRuns until setMaxSkippedRuns() is called) runs anyway.
+    void setDeadline(Priority priority, std::chrono::steady_clock::time_point deadline) {
+        deadlines[static_cast<int>(priority)] = deadline;
+    }
+    void setMaxSkippedRuns(int runs) {
+        maxSkippedRuns = runs;
+    }
+    // A disabled task is skipped in every run, whatever its priority, deadline and skipped runs are. Those runs don't
+    // count towards maxSkippedRuns, so after enabling it again its deadline is checked right away.
+    void setDisabled(Task task, bool disabled) {
+        Node& node = nodes.at(task);
+        node.disabled = disabled;
+        if (disabled)
+            node.skippedRuns = 0;
+    }
+
+    // Whether the task was skipped in the last run.
+    bool wasSkipped(Task task) const {
+        return nodes.at(task).skipped;
+    }
+
+    // Records every executed task of the following runs into the trace, one frame per run.
+    void setTrace(TaskTrace* trace, const char* group = "") {
+        this->trace = trace;
+        traceGroup = group;
+    }
+
+    // Tasks of an urgent graph are taken before all other pool jobs, tasks of other graphs yield to them.
+    void setUrgent(bool value) {
+        urgent.store(value, std::memory_order_relaxed);
+    }
+
+    // Smoothed runtime of the task and the smoothed length of the critical path from its start to the end of the graph.
+    float getCostUs(Task task) const {
+        return nodes.at(task).costUs;
+    }
+    float getRankUs(Task task) const {
+        return nodes.at(task).rankUs;
+    }
+
+private:
+    // Weight of the newest measurement in the runtime average.
+    static constexpr float costSmoothing = 0.1f;
+
+    struct Node final : public PoolJob {
+        Node(TaskGraph* graph, size_t index, std::function<void()> task, Priority priority, const char* name)
+            : graph(graph), index(index), task(std::move(task)), priority(priority), name(name) {}
+        void execute() override {
+            graph->runFrom(this);
+        }
+
+        TaskGraph* graph;
+        size_t index;
+        std::function<void()> task;
+        Priority priority;
+        const char* name;
+        int64_t readyUs = 0;
+        std::vector<Node*> successors;
+        // The successors that this node made ready in the current run, besides the continuation. Only touched by the
+        // thread that executes the node.
+        std::vector<Node*> readySuccessors;
+        int dependencies = 0;
+        std::atomic<int> pending{0};
+        std::atomic<bool> inputSkipped{false};
+        bool skipped = false;
+        bool disabled = false;
+        int skippedRuns = 0;
+        float costUs = 0.f;
+        float rankUs = 0.f;
+        bool measured = false;
+    };
+
+    static bool higherRank(const Node* a, const Node* b) {
+        return a->rankUs > b->rankUs || (a->rankUs == b->rankUs && a->index < b->index);
+    }
+
+    // The nodes are stored in topological order, so one backward pass computes all ranks. Sorting in place doesn't
+    // allocate.
+    void updatePriorities() {
+        for (auto it = nodes.rbegin(); it != nodes.rend(); ++it) {
+            float longestSuccessor = 0.f;
+            for (const Node* succ : it->successors)
+                longestSuccessor = std::max(longestSuccessor, succ->rankUs);
+            it->rankUs = it->costUs + longestSuccessor;
+        }
+        for (Node& node : nodes)
+            std::sort(node.successors.begin(), node.successors.end(), higherRank);
+        std::sort(roots.begin(), roots.end(), higherRank);
+    }
+
+    void launch(Node* node) {
+        markReady(node);
+        pool->post(node, urgent.load(std::memory_order_relaxed));
+    }
+
+    // ready is sorted by descending rank. The calling worker takes its own deque back newest first, so there the nodes
+    // are posted in ascending order and it executes the most critical one first. Thieves then take the least
+    // critical ones, the shared queues are first in first out and get the descending order.
+    void launchInRankOrder(const std::vector<Node*>& ready) {
+        if (pool->postsToOwnDeque(urgent.load(std::memory_order_relaxed))) {
+            for (auto it = ready.rbegin(); it != ready.rend(); ++it)
+                launch(*it);
+        } else {
+            for (Node* node : ready)
+                launch(node);
+        }
+    }
+
+    void markReady(Node* node) {
+        if (trace != nullptr)
+            node->readyUs = trace->nowUs();
+    }
+
+    bool shouldSkip(const Node* node, std::chrono::steady_clock::time_point now) const {
+        if (node->disabled)
+            return true;
+        if (node->priority == Priority::REQUIRED)
+            return false;
+        if (node->inputSkipped.load(std::memory_order_relaxed))
+            return true;
+        if (node->skippedRuns >= maxSkippedRuns)
+            return false;
+        const auto expectedEnd = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                               std::chrono::duration<float, std::micro>(node->rankUs));
+        return expectedEnd > deadlines[static_cast<int>(node->priority)];
+    }
+
+    void runFrom(Node* node) {
+        while (node != nullptr) {
+            const auto start = std::chrono::steady_clock::now();
+            node->skipped = shouldSkip(node, start);
+            if (node->skipped) {
+                if (!node->disabled)
+                    node->skippedRuns++;
+            } else {
+                if (node->task)
+                    node->task();
+                const float durationUs =
+                        std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count();
+                node->costUs =
+                        node->measured ? node->costUs + costSmoothing * (durationUs - node->costUs) : durationUs;
+                node->measured = true;
+                node->skippedRuns = 0;
+                if (trace != nullptr && node->task) {
+                    trace->record({node->name, traceGroup, traceFrame, node->readyUs, trace->toUs(start),
+                                   trace->toUs(start) + static_cast<int64_t>(durationUs), ThreadPool::workerIndex()});
+                }
+            }
+
+            // The successors are sorted by descending rank, the first ready one is the continuation.
+            Node* next = nullptr;
+            node->readySuccessors.clear();
+            for (Node* succ : node->successors) {
+                // Published by the release of the pending counter below.
+                if (node->skipped)
+                    succ->inputSkipped.store(true, std::memory_order_relaxed);
+                if (succ->pending.fetch_sub(1, std::memory_order_acq_rel) != 1)
+                    continue;
+                if (next == nullptr) {
+                    next = succ;
+                    markReady(succ);
+                } else {
+                    node->readySuccessors.push_back(succ);
+                }
+            }
+            if (next != nullptr && !urgent.load(std::memory_order_relaxed) && pool->hasUrgentWork()) {
+                node->readySuccessors.insert(node->readySuccessors.begin(), next);
+                next = nullptr;
+            }
+            launchInRankOrder(node->readySuccessors);
+
+            if (unfinished.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                finish();
+            node = next;
+        }
+    }
+
+    void finish() {
+        updatePriorities();
+        if (finishedCallback)
+            finishedCallback();
+        // Nothing of this graph must be touched after it stopped running.
+        ThreadPool* p = pool;
+        running.store(false, std::memory_order_release);
+        p->notifyWaiting();
+    }
+
+    ThreadPool* pool;
+    std::deque<Node> nodes;
+    std::vector<Node*> roots;
+    std::atomic<size_t> unfinished{0};
+    std::atomic<bool> running{false};
+    std::atomic<bool> urgent{false};
+    std::function<void()> finishedCallback;
+    TaskTrace* trace = nullptr;
+    const char* traceGroup = "";
+    uint64_t traceFrame = 0;
+    std::chrono::steady_clock::time_point deadlines[3] = {std::chrono::steady_clock::time_point::max(),
+                                                          std::chrono::steady_clock::time_point::max(),
+                                                          std::chrono::steady_clock::time_point::max()};
+    static constexpr int defaultMaxSkippedRuns = 5;
+    int maxSkippedRuns = defaultMaxSkippedRuns;
 };
 
 // AsyncCallback is meant for functions that should be repeatedly executed asynchronously without generating a new
@@ -10,7 +10,7 @@ namespace htwk {
 
 #define fast_round(x) (((int)((x) + 100.5f)) - 100)
 
-void BallFeatureExtractor::getFeature(const ObjectHypothesis& p, const uint8_t* img, const int featureSize,
+void BallFeatureExtractor::getFeature(const ObjectHypothesis& p, const PlanarImage& img, const int featureSize,
                                       float* dest) {
     const float scale = 0.5f * p.r * FEATURE_SCALE / (featureSize / 2);
 
@@ -36,7 +36,7 @@ void BallFeatureExtractor::getFeature(const ObjectHypothesis& p, const uint8_t*
     postprocessFeature(cnt, cyValues, dest);
 }
 
-void BallFeatureExtractor::getFeatureYUV(const ObjectHypothesis& p, const uint8_t* img, const int featureSize,
+void BallFeatureExtractor::getFeatureYUV(const ObjectHypothesis& p, const PlanarImage& img, const int featureSize,
                                          float* dest) {
     const float scale = 0.5f * p.r * FEATURE_SCALE / (featureSize / 2);
 
@@ -83,7 +83,7 @@ void BallFeatureExtractor::getFeatureYUV(const ObjectHypothesis& p, const uint8_
     memcpy(dest, fvalues.data(), fvalues.size() * sizeof(float));
 }
 
-void BallFeatureExtractor::getModifiedFeature(const ObjectHypothesis& p, const uint8_t* img, const int featureSize,
+void BallFeatureExtractor::getModifiedFeature(const ObjectHypothesis& p, const PlanarImage& img, const int featureSize,
                                               float* dest, const bool mirrored, const float rotation) {
     const float scale = p.r * FEATURE_SCALE / (featureSize / 2);
 
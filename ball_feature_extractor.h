@@ -3,6 +3,7 @@
 
 #include "base_detector.h"
 #include "object_hypothesis.h"
+#include "planar_image.h"
 
 namespace htwk {
 
@@ -10,10 +11,10 @@ class BallFeatureExtractor : public BaseDetector {
 public:
     using BaseDetector::BaseDetector;
 
-    void getFeature(const ObjectHypothesis& p, const uint8_t* img, int featureSize, float* dest);
-    void getFeatureYUV(const ObjectHypothesis& p, const uint8_t* img, const int featureSize, float* dest);
-    void getModifiedFeature(const ObjectHypothesis& p, const uint8_t* img, int featureSize, float* dest, bool mirrored,
-                            float rotation);
+    void getFeature(const ObjectHypothesis& p, const PlanarImage& img, int featureSize, float* dest);
+    void getFeatureYUV(const ObjectHypothesis& p, const PlanarImage& img, const int featureSize, float* dest);
+    void getModifiedFeature(const ObjectHypothesis& p, const PlanarImage& img, int featureSize, float* dest,
+                            bool mirrored, float rotation);
 
 private:
     static constexpr float FEATURE_SCALE = 1.7f;
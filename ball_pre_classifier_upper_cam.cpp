@@ -23,7 +23,7 @@ BallPreClassifierUpperCam::BallPreClassifierUpperCam(int8_t* lutCb, int8_t* lutC
 /*
  * detects the ball (if visible) and outputs its position
  */
-void BallPreClassifierUpperCam::proceed(const uint8_t* img, std::shared_ptr<FieldBorderDetector> fieldBorderDetector, std::vector<ObjectHypothesis>& hypoList) {
+void BallPreClassifierUpperCam::proceed(const PlanarImage& img, std::shared_ptr<FieldBorderDetector> fieldBorderDetector, std::vector<ObjectHypothesis>& hypoList) {
     Timer t("BallPreClassifierUpperCam", 50);
     EASY_FUNCTION(profiler::colors::Green);
 
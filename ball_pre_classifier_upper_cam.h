@@ -13,6 +13,7 @@
 #include "htwk_vision_config.h"
 #include "integral_image.h"
 #include "object_hypothesis.h"
+#include "planar_image.h"
 #include "tfliteexecuter.h"
 
 namespace htwk {
@@ -25,7 +26,7 @@ public:
     BallPreClassifierUpperCam(int8_t* lutCb, int8_t* lutCr, BallFeatureExtractor* featureExtractor, HtwkVisionConfig& config);
     ~BallPreClassifierUpperCam() override = default;
 
-    void proceed(const uint8_t* img, std::shared_ptr<FieldBorderDetector> fieldBorderDetector, std::vector<ObjectHypothesis>& hypoList);
+    void proceed(const PlanarImage& img, std::shared_ptr<FieldBorderDetector> fieldBorderDetector, std::vector<ObjectHypothesis>& hypoList);
 
     const std::optional<ObjectHypothesis>& getBall() const override {
         return bestBallHypothesis;
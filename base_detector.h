@@ -2,6 +2,7 @@
 
 #include <color.h>
 #include <htwk_vision_config.h>
+#include <planar_image.h>
 #include <range_check.h>
 
 #include <chrono>
@@ -62,6 +63,27 @@ public:
         return img[((x + y * width) << 1) | 3];
     }
 
+    inline color getColor(const PlanarImage& img, int32_t x, int32_t y) const __attribute__((pure)) {
+        CHECK_RANGE(x, 0, width - 1);
+        CHECK_RANGE(y, 0, height - 1);
+        return {img.getY(x, y), img.getCb(x, y), img.getCr(x, y)};
+    }
+    inline uint8_t getY(const PlanarImage& img, int32_t x, int32_t y) const __attribute__((pure)) {
+        CHECK_RANGE(x, 0, width - 1);
+        CHECK_RANGE(y, 0, height - 1);
+        return img.getY(x, y);
+    }
+    inline uint8_t getCb(const PlanarImage& img, int32_t x, int32_t y) const __attribute__((pure)) {
+        CHECK_RANGE(x, 0, width - 1);
+        CHECK_RANGE(y, 0, height - 1);
+        return img.getCb(x, y);
+    }
+    inline uint8_t getCr(const PlanarImage& img, int32_t x, int32_t y) const __attribute__((pure)) {
+        CHECK_RANGE(x, 0, width - 1);
+        CHECK_RANGE(y, 0, height - 1);
+        return img.getCr(x, y);
+    }
+
     inline void setY(uint8_t* const img, const int32_t x, int32_t y, const uint8_t c) __attribute__((nonnull)) {
         CHECK_RANGE(x, 0, width - 1);
         CHECK_RANGE(y, 0, height - 1);
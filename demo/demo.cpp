@@ -14,6 +14,7 @@
 #include <htwkyuv422image.h>
 #include <hypotheses_generator.h>
 #include <localization_utils.h>
+#include <vision_rig.h>
 
 using namespace htwk;
 using namespace htwk::image;
@@ -483,6 +484,8 @@ void handleProgramArguments(bpo::variables_map &varmap, int argc, char **argv) {
     tmp = tmp("cycles,c", bpo::value<int>()->default_value(1), "How often process a image with the vision.");
     tmp = tmp("resultImages,r", bpo::value<std::string>()->default_value(""), "Path for result images.");
     tmp = tmp("writeTimeFile,w", bpo::value<bool>()->default_value(false), "Write a time.csv file");
+    tmp = tmp("trace,t", bpo::value<std::string>()->default_value(""),
+              "Write a Chrome trace (chrome://tracing) of all vision tasks of a directory run to this file.");
 
     bpo::store(bpo::parse_command_line(argc, argv, options_all), varmap);  // parse and store
 
@@ -581,7 +584,7 @@ struct ipr {
     std::string name;
 };
 
-void processDirectory(const std::string &path, int processingCount, const std::string &debugPath, const bool writeTimeFile, ThreadPool* pool) {
+void processDirectory(const std::string &path, int processingCount, const std::string &debugPath, const bool writeTimeFile, const std::string &traceFile, ThreadPool* pool) {
     std::deque<ipr> images;
 
     /* We don't want to see all the loading and converting of pngs. We cache the raw data in memory */
@@ -606,58 +609,67 @@ void processDirectory(const std::string &path, int processingCount, const std::s
     HtwkVisionConfig upperConfig;
     HtwkVisionConfig lowerConfig;
     lowerConfig.isUpperCam = false;
-    HTWKVision upperVision(upperConfig, pool);
-    HTWKVision lowerVision(lowerConfig, pool);
-    std::string statsFileUpper;
-    std::string statsFileLower;
-    statsFileUpper.append(path + "/timeUpper.csv");
-    statsFileLower.append(path + "/timeLower.csv");
+    VisionRig rig(upperConfig, lowerConfig, pool);
+    HTWKVision &upperVision = *rig.upper;
+    HTWKVision &lowerVision = *rig.lower;
+
+    TaskTrace trace;
+    if (!traceFile.empty()) {
+        upperVision.setTaskTrace(&trace);
+        lowerVision.setTaskTrace(&trace);
+    }
 
+    // Upper and lower images are processed in pairs, like the robot gets them.
+    std::vector<const ipr *> upperImages;
+    std::vector<const ipr *> lowerImages;
     for (const ipr &img : images) {
-        boost::filesystem::path p(img.name);
-        std::string imgName = p.filename().string();
-        bool isUpper = (imgName.find("_U.") != std::string::npos);
-        std::cout << imgName << std::endl;
-
-        CamPose cam_pose = getCamPoseFromMetadata(img.metadata);
-        if (isUpper) {
-            for (int i = 0; i < processingCount; i++) {
-                upperVision.proceed(img.img, cam_pose);
-            }
-            if (writeTimeFile)
-                ;
-            // upperVision.writeProfilingFile(statsFileUpper,imgName);
-            // TODO time measuerment missing
-        } else {
-            for (int i = 0; i < processingCount; i++) {
-                lowerVision.proceed(img.img, cam_pose);
-            }
-            if (writeTimeFile)
-                ;
-            // TODO time measuerment missing
-            // lowerVision.writeProfilingFile(statsFileLower,imgName);
+        bool isUpper = (bf::path(img.name).filename().string().find("_U.") != std::string::npos);
+        (isUpper ? upperImages : lowerImages).push_back(&img);
+    }
+
+    for (size_t i = 0; i < std::max(upperImages.size(), lowerImages.size()); i++) {
+        const ipr *upperImg = i < upperImages.size() ? upperImages[i] : nullptr;
+        const ipr *lowerImg = i < lowerImages.size() ? lowerImages[i] : nullptr;
+        CamPose upperCamPose = upperImg ? getCamPoseFromMetadata(upperImg->metadata) : CamPose();
+        CamPose lowerCamPose = lowerImg ? getCamPoseFromMetadata(lowerImg->metadata) : CamPose();
+        for (const ipr *img : {upperImg, lowerImg})
+            if (img)
+                std::cout << bf::path(img->name).filename().string() << std::endl;
+
+        for (int j = 0; j < processingCount; j++) {
+            rig.proceed(upperImg ? upperImg->img : nullptr, upperCamPose, lowerImg ? lowerImg->img : nullptr,
+                        lowerCamPose);
         }
 
         if (!debugPath.empty()) {
-            if (isUpper) {
-                writeDebugFiles(debugPath + "/" + imgName, STD_WIDTH, STD_HEIGHT, img.img, upperVision, cam_pose);
-            } else {
-                writeDebugFiles(debugPath + "/" + imgName, STD_WIDTH, STD_HEIGHT, img.img, lowerVision, cam_pose);
+            if (upperImg) {
+                writeDebugFiles(debugPath + "/" + bf::path(upperImg->name).filename().string(), STD_WIDTH, STD_HEIGHT,
+                                upperImg->img, upperVision, upperCamPose);
+            }
+            if (lowerImg) {
+                writeDebugFiles(debugPath + "/" + bf::path(lowerImg->name).filename().string(), STD_WIDTH, STD_HEIGHT,
+                                lowerImg->img, lowerVision, lowerCamPose);
             }
         }
     }
     if (!writeTimeFile) {
-        printf("\n\nUpper Camera timing:\n");
-        // TODO time measuerment missing
-        // upperVision.printProfilingResults(true);
-        printf("\nLower Camera timing:\n");
-        // lowerVision.printProfilingResults(true);
+        for (CamID cam : {CamID::UPPER, CamID::LOWER}) {
+            const VisionRig::CameraStats &stats = rig.getStats(cam);
+            printf("\n%s Camera: %lu frames, %lu deadline misses, worst frame %.2fms\n",
+                   cam == CamID::UPPER ? "Upper" : "Lower", stats.frames, stats.deadlineMisses, stats.worstFrameMs);
+        }
     }
 
     high_resolution_clock::time_point t2 = high_resolution_clock::now();
     duration<double> time_span = duration_cast<duration<double>>(t2 - t1);
     std::cout << "time: " << time_span.count() * 1000 << "ms\n";
 
+    if (!traceFile.empty()) {
+        trace.writeChromeTrace(traceFile);
+        if (trace.droppedEvents() > 0)
+            printf("Trace was full, dropped %zu tasks.\n", trace.droppedEvents());
+    }
+
     for (const ipr &img : images) {
         free(img.img);
     }
@@ -720,6 +732,7 @@ int main(int argc, char **argv) {
     const int processingCount = max(1, varmap["cycles"].as<int>());
     const bool writeTime = varmap["writeTimeFile"].as<bool>();
     string writeDebugFiles = varmap["resultImages"].as<string>();
+    string traceFile = varmap["trace"].as<string>();
 
     std::set<std::string> whitelist;
 
@@ -734,7 +747,7 @@ int main(int argc, char **argv) {
     } else {
         std::string path = varmap["dir"].as<std::string>();
         if (whitelist.empty()) {
-            processDirectory(path, processingCount, writeDebugFiles, writeTime, &pool);
+            processDirectory(path, processingCount, writeDebugFiles, writeTime, traceFile, &pool);
         } else {
             processDirectoryWithWhitelist(path, whitelist, writeDebugFiles, &pool);
         }
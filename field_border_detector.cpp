@@ -10,8 +10,7 @@ FieldBorderDetector::FieldBorderDetector(int8_t* lutCb, int8_t* lutCr, HtwkVisio
       inputWidth(config.fieldBorderWidth),
       inputHeight(config.fieldBorderHeight),
       shouldWeClassify(config.fieldBorderClassifyData),
-      fieldBorderFull(config.width, 0),
-      imgPreprocessor(lutCb, lutCr, config, config.fieldBorderWidth, config.fieldBorderHeight) {
+      fieldBorderFull(config.width, 0) {
 
     if (shouldWeClassify) {
         tflite.loadModelFromFile(config.tflitePath + "/uc-field-border-classifier.tflite",
@@ -27,7 +26,7 @@ FieldBorderDetector::~FieldBorderDetector() {
         free(input);
 }
 
-void FieldBorderDetector::proceed(uint8_t* img) {
+void FieldBorderDetector::proceed(std::shared_ptr<ImagePreprocessor> imagePreprocessor) {
     Timer t("FieldBorderDetector", 50);
     EASY_FUNCTION();
 
@@ -35,9 +34,8 @@ void FieldBorderDetector::proceed(uint8_t* img) {
     if (!config.isUpperCam)
         return;
 
-//    createInputData(img);
-    imgPreprocessor.proceed(img);
-    memcpy(input, imgPreprocessor.getScaledImage().data(), sizeof(*input)*channels * inputWidth * inputHeight);
+    if (!imagePreprocessor->hasTensorSink(input))
+        memcpy(input, imagePreprocessor->getScaledImage().data(), sizeof(*input)*channels * inputWidth * inputHeight);
 
     if (!shouldWeClassify)
         return;
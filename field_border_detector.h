@@ -21,17 +21,22 @@ public:
     FieldBorderDetector& operator=(FieldBorderDetector&&) = delete;
     ~FieldBorderDetector();
 
-    void proceed(uint8_t* img);
+    // Uses the scaled image of the field border size (fieldBorderWidth x fieldBorderHeight).
+    void proceed(std::shared_ptr<ImagePreprocessor> imagePreprocessor);
 
     const std::vector<int>& getConvexFieldBorder() const {
         return fieldBorderFull;
     }
 
     const std::vector<float> getInputParameter() {
-        //        std::vector<float> tmpInput(channels * inputWidth * inputHeight);
-        //        memcpy(tmpInput.data(), input, tmpInput.size() * sizeof(float));
-        //        return tmpInput;
-        return imgPreprocessor.getScaledImage();
+        std::vector<float> tmpInput(channels * inputWidth * inputHeight);
+        memcpy(tmpInput.data(), input, tmpInput.size() * sizeof(float));
+        return tmpInput;
+    }
+
+    // The ImagePreprocessor can write straight into this, see ImagePreprocessor::addTensorSink().
+    float* getInputTensor() const {
+        return input;
     }
 
     void drawInputParameter(uint8_t* yuvImage);
@@ -45,8 +50,6 @@ private:
 
     std::vector<int> fieldBorderFull;
 
-    ImagePreprocessor imgPreprocessor;
-
     TFLiteExecuter tflite;
     float* input;
 
@@ -1,5 +1,6 @@
 #include "field_color_detector.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 #include <cmath>
@@ -35,14 +36,49 @@ const float FieldColorDetector::thetas[62]={-0.003928473492851304, 0.32675912974
  * detects the yCbCr color of the playing field in the image.
  * saves two histograms with rating values for different color combinations
  */
-void FieldColorDetector::proceed(const uint8_t *img) {
+void FieldColorDetector::proceed(const PlanarImage& img) {
     Timer t("FieldColorDetector", 50);
     EASY_FUNCTION(profiler::colors::Blue100);
 
+    const int phases = std::min(config.fieldColorPhases, maxPhases);
+    if (phases > 1 && hasEstimate) {
+        proceedIncremental(img, phases);
+        return;
+    }
 	resetArrays();
-	searchInitialSeed(img);
+	searchInitialSeed(img, 0, 1, phases > 1 ? incrementalHistWeight : 1);
 	extractFeatures(img,features);
+	greenCy=seedY;
+	greenCb=seedCb;
+	greenCr=seedCr;
 	setYCbCrCube(features);
+	hasEstimate=true;
+	phase=0;
+}
+
+/**
+ * Only looks at every phases-th sample row. The histograms lose 1/phases of their weight per frame, so they always
+ * hold about one frame worth of samples. The cube is only estimated again if the seed color drifted away from it.
+ */
+void FieldColorDetector::proceedIncremental(const PlanarImage& img, int phases) {
+    phase = (phase + 1) % phases;
+    for (std::array<int, 256>* hist : {&histY, &histCb, &histCr})
+        for (int& bin : *hist)
+            bin -= bin / phases;
+    searchInitialSeed(img, phase, phases, incrementalHistWeight);
+
+    float frameFeatures[NUM_FEATURES];
+    extractFeatures(img, frameFeatures, phase, phases);
+    for (int i = 0; i < NUM_FEATURES; i++)
+        features[i] += (frameFeatures[i] - features[i]) / phases;
+
+    const int drift = config.fieldColorDriftThreshold;
+    if (abs(seedY - greenCy) > drift || abs(seedCb - greenCb) > drift || abs(seedCr - greenCr) > drift) {
+        greenCy = seedY;
+        greenCb = seedCb;
+        greenCr = seedCr;
+        setYCbCrCube(features);
+    }
 }
 /**
  * dynamic YCbCr-cube size estimation used for green classification
@@ -95,11 +131,23 @@ void FieldColorDetector::setYCbCrCube(float* features){
     this->maxCy2=(int)(greenCy+maxCy*greenGain);
     this->maxCb2=(int)(greenCb+maxCb*greenGain);
     this->maxCr2=(int)(greenCr+maxCr*greenGain);
+    updateGreenLut();
+}
+
+void FieldColorDetector::updateGreenLut() {
+    auto channelBits = [](int v, int min, int max, int min2, int max2) {
+        return (uint8_t)((v >= min && v <= max ? GREEN : 0) | (v >= min2 && v <= max2 ? MAYBE_GREEN : 0));
+    };
+    for (int v = 0; v < 256; v++) {
+        greenLutY[v] = channelBits(v, minCy, maxCy, minCy2, maxCy2);
+        greenLutCb[v] = channelBits(v, minCb, maxCb, minCb2, maxCb2);
+        greenLutCr[v] = channelBits(v, minCr, maxCr, minCr2, maxCr2);
+    }
 }
 /**
  * extraction of image features
  */
-void FieldColorDetector::extractFeatures(const uint8_t* img, float* features){
+void FieldColorDetector::extractFeatures(const PlanarImage& img, float* features, int phase, int phases){
 	int cnt=0;
 	float meanY=0;
 	float varY=0;
@@ -107,7 +155,7 @@ void FieldColorDetector::extractFeatures(const uint8_t* img, float* features){
 	float varCr=0;
 	float sumGreen1=0;
 	float sumGreen2=0;
-	for(int y=pixelSpacing/2;y<height;y+=pixelSpacing){
+	for(int y=pixelSpacing/2+phase*pixelSpacing;y<height;y+=pixelSpacing*phases){
 		for(int x=pixelSpacing/2;x<width;x+=pixelSpacing){
 			int cy=getY(img,x,y);
 			int cb=getCb(img,x,y);
@@ -129,14 +177,14 @@ void FieldColorDetector::extractFeatures(const uint8_t* img, float* features){
 	varCb=sqrtf(varCb/cnt);
 	varCr=sqrtf(varCr/cnt);
 	meanY/=cnt;
-	for(int y=pixelSpacing/2;y<height;y+=pixelSpacing){
+	for(int y=pixelSpacing/2+phase*pixelSpacing;y<height;y+=pixelSpacing*phases){
 		for(int x=pixelSpacing;x<width;x+=pixelSpacing){
 			int cy=getY(img,x,y);
 			varY+=(cy-meanY)*(cy-meanY);
 		}
 	}
 	varY=sqrtf(varY/cnt);
-    features[0]=greenCy/256.f;
+    features[0]=seedY/256.f;
 	features[1]=varY/32;
 	features[2]=varCb/16;
 	features[3]=varCr/16;
@@ -150,27 +198,27 @@ void FieldColorDetector::extractFeatures(const uint8_t* img, float* features){
 /**
  * dominant color search for green detection
  */
-void FieldColorDetector::searchInitialSeed(const uint8_t * const img){
+void FieldColorDetector::searchInitialSeed(const PlanarImage& img, int phase, int phases, int weight){
 
 	//building histogram of all cr-channel
 	int seedSearchBorder=width/16;
-	for(int y=seedSearchBorder;y<height-1-seedSearchBorder;y+=pixelSpacing){
+	for(int y=seedSearchBorder+phase*pixelSpacing;y<height-1-seedSearchBorder;y+=pixelSpacing*phases){
 		for(int x=seedSearchBorder;x<width-seedSearchBorder;x+=pixelSpacing){
 			int cr=getCr(img,x,y);
-			histCr[cr]++;
+			histCr[cr]+=weight;
 		}
 	}
 
 	//finding initial cr-value (later used as a seed color)
-    seedCr=clamp(getStableMin(histCr,minFieldArea),colorBorder,255-colorBorder);
+    seedCr=clamp(getStableMin(histCr,minFieldArea*weight),colorBorder,255-colorBorder);
 
 	//build histogram of cb-channel for promising pixels
-	for(int y=0;y<height-1;y+=pixelSpacing){
+	for(int y=phase*pixelSpacing;y<height-1;y+=pixelSpacing*phases){
 		for(int x=0;x<width;x+=pixelSpacing){
 			int cr=getCr(img,x,y);
 			if(abs(cr-seedCr)<4){
 				int cb=getCb(img,x,y);
-				histCb[cb]++;
+				histCb[cb]+=weight;
 			}
 		}
 	}
@@ -178,23 +226,20 @@ void FieldColorDetector::searchInitialSeed(const uint8_t * const img){
     seedCb=clamp(getPeak(histCb),colorBorder,255-colorBorder);
 
 	//build histogram of y-channel for promising pixels
-	for(int y=0;y<height-1;y+=pixelSpacing){
+	for(int y=phase*pixelSpacing;y<height-1;y+=pixelSpacing*phases){
 		for(int x=0;x<width;x+=pixelSpacing){
 			int cr=getCr(img,x,y);
 			if(abs(cr-seedCr)<8){
 				int cb=getCb(img,x,y);
 				if(abs(cb-seedCb)<8){
 					int cy=getY(img,x,y);
-					histY[cy]++;
+					histY[cy]+=weight;
 				}
 			}
 		}
 	}
 	//finding initial y-value (later used as a seed color)
     seedY=clamp(getPeak(histY),colorBorder,255-colorBorder);
-	greenCy=seedY;
-	greenCb=seedCb;
-	greenCr=seedCr;
 }
 
 void FieldColorDetector::resetArrays() {
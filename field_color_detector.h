@@ -7,6 +7,7 @@
 
 #include "base_detector.h"
 #include "color.h"
+#include "planar_image.h"
 #include "range_check.h"
 
 namespace htwk {
@@ -14,6 +15,9 @@ namespace htwk {
 class FieldColorDetector : public BaseDetector {
 private:
     static constexpr int NUM_FEATURES = 7;
+    static constexpr int maxPhases = 8;
+    // Histogram weight of a sample in incremental mode, so that decaying them doesn't round small bins away.
+    static constexpr int incrementalHistWeight = 16;
 
     int minCy2{};
     int maxCy2{};
@@ -40,6 +44,29 @@ private:
     int seedCb{};
     int seedY{};
 
+    bool hasEstimate = false;
+    int phase = 0;
+
+    void proceedIncremental(const PlanarImage& img, int phases);
+
+    // The cubes are axis aligned, so a color is green if all three of its channels are. Per channel value bit 0 says
+    // if it is inside the isGreen() cube and bit 1 if it is inside the maybeGreen() cube. Made by setYCbCrCube(),
+    // until then both cubes only hold (0, 0, 0).
+    static constexpr uint8_t GREEN = 1;
+    static constexpr uint8_t MAYBE_GREEN = 2;
+    std::array<uint8_t, 256> greenLutY{{GREEN | MAYBE_GREEN}};
+    std::array<uint8_t, 256> greenLutCb{{GREEN | MAYBE_GREEN}};
+    std::array<uint8_t, 256> greenLutCr{{GREEN | MAYBE_GREEN}};
+
+    void updateGreenLut();
+
+    inline uint8_t greenBits(int cy, int cb, int cr) const {
+        CHECK_RANGE(cy, 0, 255);
+        CHECK_RANGE(cb, 0, 255);
+        CHECK_RANGE(cr, 0, 255);
+        return greenLutY[cy] & greenLutCb[cb] & greenLutCr[cr];
+    }
+
 public:
     int minCy{};
     int maxCy{};
@@ -50,10 +77,11 @@ public:
 
     using BaseDetector::BaseDetector;
 
-    void proceed(const uint8_t* img) __attribute__((nonnull));
-    void searchInitialSeed(const uint8_t* img);
+    void proceed(const PlanarImage& img);
+    // Only the sample rows phase, phase + phases, ... are used, every sample adds weight to the histograms.
+    void searchInitialSeed(const PlanarImage& img, int phase = 0, int phases = 1, int weight = 1);
 	void setYCbCrCube(float* features);
-    void extractFeatures(const uint8_t* img, float* features);
+    void extractFeatures(const PlanarImage& img, float* features, int phase = 0, int phases = 1);
     static int getStableMin(const std::array<int, 256>& hist, int thres);
     static int getPeak(const std::array<int, 256>& hist);
 
@@ -65,59 +93,38 @@ public:
     }
 
 	inline bool maybeGreen(int cyReal, int cbReal, int crReal) const {
-		if(crReal>maxCr2)return false; //44705
-		if(cyReal>maxCy2)return false; //30018
-		if(cbReal>maxCb2)return false; //7576
-		if(cbReal<minCb2)return false; //2171
-		if(crReal<minCr2)return false; //353
-		if(cyReal<minCy2)return false; //68
-		return true;
+		return greenBits(cyReal, cbReal, crReal) & MAYBE_GREEN;
 	}
 
     /**
      * Test, if a given yuv-color matches the field-color (used to detect all pixels on the carpet)
      */
     inline bool isGreen(int cyReal, int cbReal, int crReal) const {
-    	if(crReal>maxCr)return false; //44705
-		if(cyReal>maxCy)return false; //30018
-		if(cbReal>maxCb)return false; //7576
-		if(cbReal<minCb)return false; //2171
-		if(crReal<minCr)return false; //353
-		if(cyReal<minCy)return false; //68
-		return true;
+        return greenBits(cyReal, cbReal, crReal) & GREEN;
     }
 
     inline bool isGreen(const uint8_t * const img, int x, int y) const {
-		int cr=getCr(img,x,y);
-    	int cy=getY(img,x,y);
-		int cb=getCb(img,x,y);
-        return 1-(1&
-                  (((cy-minCy)>>31) | ((maxCy-cy)>>31)|
-                   ((cb-minCb)>>31) | ((maxCb-cb)>>31)|
-                   ((cr-minCr)>>31) | ((maxCr-cr)>>31)));
-//       	if(crReal>maxCr)return false; //44705
-//   		if(cyReal>maxCy)return false; //30018
-//   		if(cbReal>maxCb)return false; //7576
-//   		if(cbReal<minCb)return false; //2171
-//   		if(crReal<minCr)return false; //353
-//   		if(cyReal<minCy)return false; //68
-//   		return true;
-       }
+        return isGreen(getY(img, x, y), getCb(img, x, y), getCr(img, x, y));
+    }
 
     inline bool isGreen(const color& c) const {
-    	if(c.cr>maxCr)return false; //44705
-		if(c.cy>maxCy)return false; //30018
-		if(c.cb>maxCb)return false; //7576
-		if(c.cb<minCb)return false; //2171
-		if(c.cr<minCr)return false; //353
-		if(c.cy<minCy)return false; //68
-		return true;
+        return isGreen(c.cy, c.cb, c.cr);
     }
 
     color getColor() const {
         return {greenCy, greenCb, greenCr};
     }
 
+    struct Cube {
+        int minCy, maxCy, minCb, maxCb, minCr, maxCr;
+    };
+    // The bounds behind isGreen(), or maybeGreen() if maybe is set.
+    Cube getCube(bool maybe) const {
+        if (maybe)
+            return {minCy2, maxCy2, minCb2, maxCb2, minCr2, maxCr2};
+        return {minCy, maxCy, minCb, maxCb, minCr, maxCr};
+    }
+
 	void resetArrays();
 };
 
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+// Vector with a fixed capacity that is stored inside the object, it never allocates. push_back() returns false if the
+// vector is full and drops the element. Only for trivially copyable types, so copying the vector copies plain memory.
+template <typename T, size_t Capacity>
+class FixedVector {
+    static_assert(std::is_trivially_copyable_v<T>, "FixedVector only holds trivially copyable types");
+
+public:
+    FixedVector() = default;
+
+    bool push_back(const T& value) {
+        if (count == Capacity)
+            return false;
+        new (&storage[count * sizeof(T)]) T(value);
+        count++;
+        return true;
+    }
+
+    // Returns false if not everything fit.
+    template <typename Range>
+    bool assign(const Range& range) {
+        clear();
+        for (const T& value : range)
+            if (!push_back(value))
+                return false;
+        return true;
+    }
+
+    void clear() {
+        count = 0;
+    }
+
+    T* data() {
+        return std::launder(reinterpret_cast<T*>(storage));
+    }
+    const T* data() const {
+        return std::launder(reinterpret_cast<const T*>(storage));
+    }
+
+    T& operator[](size_t i) {
+        return data()[i];
+    }
+    const T& operator[](size_t i) const {
+        return data()[i];
+    }
+
+    T* begin() {
+        return data();
+    }
+    T* end() {
+        return data() + count;
+    }
+    const T* begin() const {
+        return data();
+    }
+    const T* end() const {
+        return data() + count;
+    }
+
+    size_t size() const {
+        return count;
+    }
+    bool empty() const {
+        return count == 0;
+    }
+    static constexpr size_t capacity() {
+        return Capacity;
+    }
+
+private:
+    alignas(T) unsigned char storage[Capacity * sizeof(T)];
+    size_t count = 0;
+};
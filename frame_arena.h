@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Storage for objects that all die at the end of a frame. create() constructs into the next free slot of a block and
+// reset() gives all slots back at once. Blocks are kept, so after the first frames nothing is allocated anymore, and
+// pointers stay valid until the next reset(). For trivially destructible types reset() is O(1).
+template <typename T, size_t BlockSize = 1024>
+class FrameArena {
+public:
+    FrameArena() = default;
+    FrameArena(const FrameArena&) = delete;
+    FrameArena(FrameArena&& other) noexcept
+        : blocks(std::move(other.blocks)), count(std::exchange(other.count, 0)) {}
+    FrameArena& operator=(const FrameArena&) = delete;
+    FrameArena& operator=(FrameArena&& other) noexcept {
+        reset();
+        blocks = std::move(other.blocks);
+        count = std::exchange(other.count, 0);
+        return *this;
+    }
+    ~FrameArena() {
+        reset();
+    }
+
+    template <typename... Args>
+    T* create(Args&&... args) {
+        if (count == blocks.size() * BlockSize)
+            blocks.emplace_back(std::make_unique<Slot[]>(BlockSize));
+        T* obj = new (blocks[count / BlockSize][count % BlockSize].data) T(std::forward<Args>(args)...);
+        count++;
+        return obj;
+    }
+
+    void reset() {
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            for (size_t i = 0; i < count; i++)
+                std::launder(reinterpret_cast<T*>(blocks[i / BlockSize][i % BlockSize].data))->~T();
+        }
+        count = 0;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+private:
+    struct Slot {
+        alignas(T) unsigned char data[sizeof(T)];
+    };
+
+    std::vector<std::unique_ptr<Slot[]>> blocks;
+    size_t count = 0;
+};
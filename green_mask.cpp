@@ -0,0 +1,149 @@
+#include "green_mask.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <emmintrin.h>
+
+#include <easy/profiler.h>
+
+namespace htwk {
+
+namespace {
+
+struct ByteRange {
+    __m128i lo;
+    __m128i hi;
+};
+
+// Byte range of a channel, empty if the cube doesn't reach into [0, 255].
+ByteRange byteRange(int min, int max) {
+    if (min > max || max < 0 || min > 255)
+        return {_mm_set1_epi8((char)255), _mm_setzero_si128()};
+    return {_mm_set1_epi8((char)std::max(min, 0)), _mm_set1_epi8((char)std::min(max, 255))};
+}
+
+inline __m128i inRange(__m128i v, const ByteRange& r) {
+    return _mm_and_si128(_mm_cmpeq_epi8(_mm_max_epu8(v, r.lo), v), _mm_cmpeq_epi8(_mm_min_epu8(v, r.hi), v));
+}
+
+struct CubeRanges {
+    ByteRange cy, cb, cr;
+
+    explicit CubeRanges(const FieldColorDetector::Cube& c)
+        : cy(byteRange(c.minCy, c.maxCy)), cb(byteRange(c.minCb, c.maxCb)), cr(byteRange(c.minCr, c.maxCr)) {}
+
+    inline uint64_t bits(__m128i y, __m128i cb, __m128i cr) const {
+        return (uint16_t)_mm_movemask_epi8(
+                _mm_and_si128(inRange(y, this->cy), _mm_and_si128(inRange(cb, this->cb), inRange(cr, this->cr))));
+    }
+};
+
+inline bool inCube(const FieldColorDetector::Cube& c, int cy, int cb, int cr) {
+    return cy >= c.minCy && cy <= c.maxCy && cb >= c.minCb && cb <= c.maxCb && cr >= c.minCr && cr <= c.maxCr;
+}
+
+}  // namespace
+
+GreenMask::GreenMask(const HtwkVisionConfig& config, int scale)
+    : scale(scale),
+      maskWidth(config.width / scale),
+      maskHeight(config.height / scale),
+      wordsPerRow((maskWidth + 63) / 64) {
+    if (scale != 1 && scale != 2) {
+        fprintf(stderr, "%s:%d: %s: scale has to be 1 or 2, not %d\n", __FILE__, __LINE__, __func__, scale);
+        exit(1);
+    }
+    green = static_cast<uint64_t*>(aligned_alloc(16, wordsPerRow * maskHeight * sizeof(uint64_t)));
+    maybeGreen = static_cast<uint64_t*>(aligned_alloc(16, wordsPerRow * maskHeight * sizeof(uint64_t)));
+}
+
+GreenMask::~GreenMask() {
+    free(green);
+    free(maybeGreen);
+}
+
+void GreenMask::proceed(const PlanarImage& img, const FieldColorDetector& field) {
+    EASY_FUNCTION();
+    const FieldColorDetector::Cube greenCube = field.getCube(false);
+    const FieldColorDetector::Cube maybeCube = field.getCube(true);
+    const CubeRanges greenRanges(greenCube);
+    const CubeRanges maybeRanges(maybeCube);
+    const __m128i lowBytes = _mm_set1_epi16(0xff);
+    for (int maskY = 0; maskY < maskHeight; maskY++) {
+        const int y = maskY * scale;
+        const uint8_t* yRow = img.getYRow(y);
+        const uint8_t* cbRow = img.getCbRow(y);
+        const uint8_t* crRow = img.getCrRow(y);
+        uint64_t* greenRow = green + maskY * wordsPerRow;
+        uint64_t* maybeRow = maybeGreen + maskY * wordsPerRow;
+        std::fill(greenRow, greenRow + wordsPerRow, 0);
+        std::fill(maybeRow, maybeRow + wordsPerRow, 0);
+
+        // 16 mask pixels per iteration. At full resolution a Cb/Cr value belongs to two pixels, at half resolution
+        // only the first of them is classified.
+        int x = 0;
+        for (; x + 16 <= maskWidth; x += 16) {
+            __m128i cy, cb, cr;
+            if (scale == 1) {
+                cy = _mm_loadu_si128((const __m128i*)(yRow + x));
+                cb = _mm_loadl_epi64((const __m128i*)(cbRow + x / 2));
+                cr = _mm_loadl_epi64((const __m128i*)(crRow + x / 2));
+                cb = _mm_unpacklo_epi8(cb, cb);
+                cr = _mm_unpacklo_epi8(cr, cr);
+            } else {
+                cy = _mm_packus_epi16(_mm_and_si128(_mm_loadu_si128((const __m128i*)(yRow + 2 * x)), lowBytes),
+                                      _mm_and_si128(_mm_loadu_si128((const __m128i*)(yRow + 2 * x + 16)), lowBytes));
+                cb = _mm_loadu_si128((const __m128i*)(cbRow + x));
+                cr = _mm_loadu_si128((const __m128i*)(crRow + x));
+            }
+            greenRow[x >> 6] |= greenRanges.bits(cy, cb, cr) << (x & 63);
+            maybeRow[x >> 6] |= maybeRanges.bits(cy, cb, cr) << (x & 63);
+        }
+        for (; x < maskWidth; x++) {
+            const int cy = img.getY(x * scale, y);
+            const int cb = img.getCb(x * scale, y);
+            const int cr = img.getCr(x * scale, y);
+            greenRow[x >> 6] |= (uint64_t)inCube(greenCube, cy, cb, cr) << (x & 63);
+            maybeRow[x >> 6] |= (uint64_t)inCube(maybeCube, cy, cb, cr) << (x & 63);
+        }
+    }
+}
+
+GreenMask::MaskBox GreenMask::toMaskBox(int x0, int y0, int x1, int y1) const {
+    // Mask pixel x is image pixel x * scale.
+    return {std::max(0, (x0 + scale - 1) / scale), std::max(0, (y0 + scale - 1) / scale),
+            std::min(maskWidth, (x1 + scale - 1) / scale), std::min(maskHeight, (y1 + scale - 1) / scale)};
+}
+
+int GreenMask::countPixels(int x0, int y0, int x1, int y1) const {
+    const MaskBox box = toMaskBox(x0, y0, x1, y1);
+    if (box.x0 >= box.x1 || box.y0 >= box.y1)
+        return 0;
+    return (box.x1 - box.x0) * (box.y1 - box.y0);
+}
+
+int GreenMask::countGreen(int x0, int y0, int x1, int y1) const {
+    const MaskBox box = toMaskBox(x0, y0, x1, y1);
+    if (box.x0 >= box.x1 || box.y0 >= box.y1)
+        return 0;
+    const int firstWord = box.x0 >> 6;
+    const int lastWord = (box.x1 - 1) >> 6;
+    const uint64_t firstMask = ~0ull << (box.x0 & 63);
+    const uint64_t lastMask = ~0ull >> (63 - ((box.x1 - 1) & 63));
+    int count = 0;
+    for (int my = box.y0; my < box.y1; my++) {
+        const uint64_t* row = green + my * wordsPerRow;
+        if (firstWord == lastWord) {
+            count += __builtin_popcountll(row[firstWord] & firstMask & lastMask);
+            continue;
+        }
+        count += __builtin_popcountll(row[firstWord] & firstMask);
+        for (int w = firstWord + 1; w < lastWord; w++)
+            count += __builtin_popcountll(row[w]);
+        count += __builtin_popcountll(row[lastWord] & lastMask);
+    }
+    return count;
+}
+
+}  // namespace htwk
@@ -0,0 +1,72 @@
+#ifndef GREEN_MASK_H
+#define GREEN_MASK_H
+
+#include <cstdint>
+
+#include <field_color_detector.h>
+#include <htwk_vision_config.h>
+#include <planar_image.h>
+
+namespace htwk {
+
+/**
+ * One bit per pixel for FieldColorDetector::isGreen() and one for maybeGreen(), made once per frame for the detectors
+ * that test a lot of pixels or count green in boxes. With scale 2 only every second pixel of every second row is
+ * classified. All coordinates are the ones of the camera image.
+ */
+class GreenMask {
+public:
+    // scale is 1 (full resolution) or 2 (half resolution).
+    GreenMask(const HtwkVisionConfig& config, int scale);
+    GreenMask(const GreenMask&) = delete;
+    GreenMask(GreenMask&&) = delete;
+    GreenMask& operator=(const GreenMask&) = delete;
+    GreenMask& operator=(GreenMask&&) = delete;
+    ~GreenMask();
+
+    // Needs the cubes of the current frame, so after FieldColorDetector::proceed().
+    void proceed(const PlanarImage& img, const FieldColorDetector& field);
+
+    inline bool isGreen(int x, int y) const {
+        return getBit(green, x, y);
+    }
+    inline bool isMaybeGreen(int x, int y) const {
+        return getBit(maybeGreen, x, y);
+    }
+
+    // Bit x % 64 of word x / 64 is mask column x, a row has wordsPerRow words.
+    inline const uint64_t* getGreenRow(int maskY) const {
+        return green + maskY * wordsPerRow;
+    }
+    inline const uint64_t* getMaybeGreenRow(int maskY) const {
+        return maybeGreen + maskY * wordsPerRow;
+    }
+
+    // Classified pixels in [x0, x1) x [y0, y1) and how many of them are green.
+    int countPixels(int x0, int y0, int x1, int y1) const;
+    int countGreen(int x0, int y0, int x1, int y1) const;
+
+    const int scale;
+    const int maskWidth;
+    const int maskHeight;
+    const int wordsPerRow;
+
+private:
+    inline bool getBit(const uint64_t* mask, int x, int y) const {
+        x /= scale;
+        y /= scale;
+        return (mask[y * wordsPerRow + (x >> 6)] >> (x & 63)) & 1;
+    }
+
+    struct MaskBox {
+        int x0, y0, x1, y1;
+    };
+    MaskBox toMaskBox(int x0, int y0, int x1, int y1) const;
+
+    uint64_t* green;
+    uint64_t* maybeGreen;
+};
+
+}  // namespace htwk
+
+#endif  // GREEN_MASK_H
@@ -2,34 +2,45 @@
 
 #include <easy/profiler.h>
 #include <hypotheses_generator_blur.h>
+#include <localization_utils.h>
+#include <tfliteexecuter.h>
+
+#include <algorithm>
 
 namespace htwk {
 
 HTWKVision::HTWKVision(HtwkVisionConfig& cfg, ThreadPool* thread_pool)
     : config(cfg), thread_pool(thread_pool) {
+    TFLiteExecuter::setSharedThreadPoolSize(std::max(1, std::min(config.nnSharedThreads, (int)thread_pool->size())));
+    // A worker that waits for the multi threaded network delegate executes other vision jobs meanwhile.
+    TFLiteExecuter::setSharedDelegateWaiter(
+            [pool = thread_pool](const std::function<bool()>& ready) { pool->waitUntil(ready); },
+            [pool = thread_pool]() { pool->notifyWaiting(); });
     createAdressLookups();
+    for (FrameSlot& slot : slots)
+        createFrameSlot(slot);
+    fieldBorderDetector = slots[0].fieldBorderDetector;
+    integralImage = slots[0].integralImage.get();
+    ucBallHypImagePreprocessor = slots[0].ucBallHypImagePreprocessor;
+    ucImagePreprocessor = slots[0].ucImagePreprocessor;
+    lcImagePreprocessor = slots[0].lcImagePreprocessor;
+
     fieldColorDetector = new FieldColorDetector(lutCb, lutCr, config);
-    fieldBorderDetector = std::make_shared<FieldBorderDetector>(lutCb, lutCr, config);
-    regionClassifier = new RegionClassifier(lutCb, lutCr, config);
+    regionClassifier = new RegionClassifier(
+            lutCb, lutCr, config, thread_pool,
+            std::min(config.regionClassifierBands, static_cast<int>(thread_pool->size())));
     lineDetector = new LineDetector(lutCb, lutCr, config);
     ballFeatureExtractor = new BallFeatureExtractor(lutCb, lutCr, config);
     ellipseFitter = new RansacEllipseFitter(lutCb, lutCr, config);
-    integralImage = new IntegralImage(lutCb, lutCr, config);
     hypothesesGenerator = new HypothesesGeneratorBlur(integralImage, lutCb, lutCr, config);
     obstacleDetectionLowCam = new LowerCamObstacleDetection(lutCb, lutCr, config);
 
-    ucBallHypImagePreprocessor =
-            std::make_shared<ImagePreprocessor>(lutCb, lutCr, config, config.ucBallHypGeneratorConfig.scaledImageWidth,
-                                                config.ucBallHypGeneratorConfig.scaledImageHeight);
     ucBallHypGenerator = std::make_shared<UpperCamBallHypothesesGenerator>(lutCb, lutCr, config, thread_pool);
 
     ballDetectorUpperCamPreClassifier =
             std::make_shared<BallPreClassifierUpperCam>(lutCb, lutCr, ballFeatureExtractor, config);
     ballDetectorUpperCamPostClassifier = std::make_shared<BallClassifierUpperCam>(lutCb, lutCr, config);
 
-    ucImagePreprocessor =
-            std::make_shared<ImagePreprocessor>(lutCb, lutCr, config, config.ucGoalPostDetectorConfig.scaledImageWidth,
-                                                config.ucGoalPostDetectorConfig.scaledImageHeight);
     ucGoalPostDetector = std::make_shared<UpperCamGoalPostDetector>(lutCb, lutCr, config);
     ucCenterCirclePointDetector = std::make_shared<UpperCamCenterCirclePointDetector>(lutCb, lutCr, config);
 
@@ -37,13 +48,10 @@ HTWKVision::HTWKVision(HtwkVisionConfig& cfg, ThreadPool* thread_pool)
             std::make_shared<UpperCamPenaltySpotClassifier>(lutCb, lutCr, ballFeatureExtractor, config);
     objectDetectorLowerCam = std::make_shared<ObjectDetectorLowCam>(lutCb, lutCr, config);
 
-    lcImagePreprocessor =
-            std::make_shared<ImagePreprocessor>(lutCb, lutCr, config, config.lcObjectDetectorConfig.scaledImageWidth,
-                                                config.lcObjectDetectorConfig.scaledImageHeight);
-    lcHypGenBall = std::make_shared<ObjectDetectorLowCamHypGen>(
-            lutCb, lutCr, config, config.lcObjectDetectorConfig.hypGenModelBall, lcImagePreprocessor);
+    lcHypGenBall = std::make_shared<ObjectDetectorLowCamHypGen>(lutCb, lutCr, config,
+                                                                config.lcObjectDetectorConfig.hypGenModelBall);
     lcHypGenPenaltySpot = std::make_shared<ObjectDetectorLowCamHypGen>(
-            lutCb, lutCr, config, config.lcObjectDetectorConfig.hypGenModelPenatlySpot, lcImagePreprocessor);
+            lutCb, lutCr, config, config.lcObjectDetectorConfig.hypGenModelPenatlySpot);
     lcCenterCirclePointDetectorCenter = std::make_shared<LowerCamCenterCirclePointDetector>(
             lutCb, lutCr, config, LowerCamCenterCirclePointDetector::CENTER);
     lcCenterCirclePointDetectorSide = std::make_shared<LowerCamCenterCirclePointDetector>(
@@ -63,15 +71,19 @@ HTWKVision::HTWKVision(HtwkVisionConfig& cfg, ThreadPool* thread_pool)
         penaltySpotDetector =
                 std::make_shared<PenaltySpotDetectorAdapter<ObjectDetectorLowCam>>(objectDetectorLowerCam);
     }
+
+    for (FrameSlot& slot : slots)
+        buildTaskGraph(slot);
 }
 
 HTWKVision::~HTWKVision() {
+    waitForPipeline();
+
     delete fieldColorDetector;
     delete regionClassifier;
     delete lineDetector;
     delete ballFeatureExtractor;
     delete ellipseFitter;
-    delete integralImage;
     delete hypothesesGenerator;
     delete obstacleDetectionLowCam;
 
@@ -79,109 +91,390 @@ HTWKVision::~HTWKVision() {
     free(lutCr);
 }
 
+void HTWKVision::createFrameSlot(FrameSlot& slot) {
+    slot.fieldBorderDetector = std::make_shared<FieldBorderDetector>(lutCb, lutCr, config);
+    slot.integralImage = std::make_shared<IntegralImage>(lutCb, lutCr, config);
+    slot.planarImage = std::make_shared<PlanarImage>(config);
+    if (config.greenMaskScale > 0)
+        slot.greenMask = std::make_shared<GreenMask>(config, config.greenMaskScale);
+
+    const std::pair<int, int> fieldBorderSize{config.fieldBorderWidth, config.fieldBorderHeight};
+    const std::pair<int, int> ucBallHypSize{config.ucBallHypGeneratorConfig.scaledImageWidth,
+                                            config.ucBallHypGeneratorConfig.scaledImageHeight};
+    const std::pair<int, int> ucSize{config.ucGoalPostDetectorConfig.scaledImageWidth,
+                                     config.ucGoalPostDetectorConfig.scaledImageHeight};
+    const std::pair<int, int> lcSize{config.lcObjectDetectorConfig.scaledImageWidth,
+                                     config.lcObjectDetectorConfig.scaledImageHeight};
+    std::vector<std::pair<int, int>> usedSizes;
+    if (config.isUpperCam) {
+        usedSizes = {fieldBorderSize, ucSize};
+        if (!config.onlyLocalization)
+            usedSizes.push_back(ucBallHypSize);
+    } else if (!config.onlyLocalization) {
+        usedSizes = {lcSize};
+    }
+    slot.imagePyramid = std::make_shared<ImagePyramid>(
+            lutCb, lutCr, config, usedSizes, thread_pool,
+            std::min(config.imagePyramidBands, static_cast<int>(thread_pool->size())));
+
+    auto getPreprocessor = [this, &slot](const std::pair<int, int>& size) {
+        std::shared_ptr<ImagePreprocessor> level = slot.imagePyramid->getLevel(size.first, size.second);
+        return level ? level : std::make_shared<ImagePreprocessor>(lutCb, lutCr, config, size.first, size.second);
+    };
+    slot.fieldBorderImagePreprocessor = getPreprocessor(fieldBorderSize);
+    slot.ucBallHypImagePreprocessor = getPreprocessor(ucBallHypSize);
+    slot.ucImagePreprocessor = getPreprocessor(ucSize);
+    slot.lcImagePreprocessor = getPreprocessor(lcSize);
+
+    // The field border detector belongs to the slot, it always gets its input straight from the pyramid.
+    if (config.isUpperCam)
+        slot.fieldBorderImagePreprocessor->addTensorSink(slot.fieldBorderDetector->getInputTensor());
+}
+
+// The detectors that don't belong to a slot may only get the scaled images straight into their input tensors if no
+// other frame is in flight. With proceedAsync() they can still be busy with the previous frame while the pyramid of
+// the next one is made, then they copy the scaled image themselves.
+void HTWKVision::setSharedTensorSinks(FrameSlot& slot, bool enabled) {
+    std::vector<std::pair<ImagePreprocessor*, ImagePreprocessor::TiledSink>> tiledSinks;
+    if (config.isUpperCam) {
+        tiledSinks = {{slot.ucImagePreprocessor.get(), ucGoalPostDetector->getTiledSink()},
+                      {slot.ucImagePreprocessor.get(), ucCenterCirclePointDetector->getTiledSink()}};
+        if (!config.onlyLocalization)
+            tiledSinks.push_back({slot.ucBallHypImagePreprocessor.get(), ucBallHypGenerator->getTiledSink()});
+    }
+    for (const auto& [preprocessor, sink] : tiledSinks) {
+        preprocessor->removeTiledSink(sink.patchRows[0]);
+        if (enabled)
+            preprocessor->addTiledSink(sink);
+    }
+
+    if (config.onlyLocalization)
+        return;
+    std::vector<std::pair<ImagePreprocessor*, float*>> sinks;
+    if (config.isUpperCam) {
+        sinks = {{slot.ucBallHypImagePreprocessor.get(), ucDirtyCameraDetector->getInputTensor()}};
+    } else {
+        sinks = {{slot.lcImagePreprocessor.get(), lcHypGenBall->getInputTensor()},
+                 {slot.lcImagePreprocessor.get(), lcHypGenPenaltySpot->getInputTensor()},
+                 {slot.lcImagePreprocessor.get(), lcScrambledCameraDetector->getInputTensor()}};
+    }
+    for (auto [preprocessor, sink] : sinks) {
+        preprocessor->removeTensorSink(sink);
+        if (enabled)
+            preprocessor->addTensorSink(sink);
+    }
+
+    if (config.isUpperCam && ucRobotDetector->getQuantizedInputTensor() != nullptr) {
+        slot.ucImagePreprocessor->removeQuantizedSink(ucRobotDetector->getQuantizedInputTensor());
+        if (enabled)
+            slot.ucImagePreprocessor->addQuantizedSink(ucRobotDetector->getQuantizedInputTensor(),
+                                                       ucRobotDetector->getInputQuantization());
+    }
+}
+
 void HTWKVision::proceed(uint8_t* img, CamPose& cam_pose, bool ultra_low_latency) {
     EASY_FUNCTION(profiler::colors::Blue);
-    TaskScheduler scheduler(thread_pool);
-
-    auto fieldBorder = scheduler.addTask([&]() { fieldBorderDetector->proceed(img); }, {});
-    if (!ultra_low_latency) {
-        auto regions = scheduler.addTask(
-                [&]() {
-                    fieldColorDetector->proceed(img);
-                    regionClassifier->proceed(img, fieldColorDetector);
-                },
-                {});
-        auto lines = scheduler.addTask(
-                [&]() {
-                    // LineDetector modifies the LineSegments from RegionClassifier.
-                    lineDetector->proceed(
-                            img, regionClassifier->getLineSegments(fieldBorderDetector->getConvexFieldBorder()),
-                            regionClassifier->lineSpacing);
-                },
-                {regions, fieldBorder});
-        if (config.isUpperCam) {
-            scheduler.addTask(
-                    [&]() {
-                        ellipseFitter->proceed(
-                                regionClassifier->getLineSegments(fieldBorderDetector->getConvexFieldBorder()), img);
-                    },
-                    {regions, fieldBorder, lines});
-        }
+    startProceed(img, cam_pose, ultra_low_latency);
+    waitForProceed();
+}
+
+void HTWKVision::startProceed(uint8_t* img, CamPose& cam_pose, bool ultra_low_latency) {
+    waitForPipeline();
+    setSharedTensorSinks(slots[0], true);
+    startFrame(slots[0], img, cam_pose, ultra_low_latency);
+}
+
+void HTWKVision::waitForProceed() {
+    slots[0].graph.graph->wait();
+}
+
+void HTWKVision::setTaskTrace(TaskTrace* trace) {
+    for (FrameSlot& slot : slots)
+        slot.graph.graph->setTrace(trace, config.isUpperCam ? "upper" : "lower");
+}
+
+void HTWKVision::setUrgent(bool urgent) {
+    for (FrameSlot& slot : slots)
+        slot.graph.graph->setUrgent(urgent);
+}
+
+std::future<VisionFrameResult> HTWKVision::proceedAsync(uint8_t* img, const CamPose& cam_pose, bool ultra_low_latency) {
+    EASY_FUNCTION(profiler::colors::Blue);
+    FrameSlot& slot = slots[nextSlot];
+    nextSlot = (nextSlot + 1) % 2;
+
+    thread_pool->waitUntil([&slot]() { return !slot.isBusy(); });
+    slot.result.emplace();
+    auto future = slot.result->get_future();
+    setSharedTensorSinks(slot, false);
+    startFrame(slot, img, cam_pose, ultra_low_latency);
+    return future;
+}
+
+void HTWKVision::startFrame(FrameSlot& slot, uint8_t* img, const CamPose& cam_pose, bool ultra_low_latency) {
+    slot.img = img;
+    slot.camPose = cam_pose;
+    slot.fieldTopRow =
+            config.roiHorizonMargin < 0 ? 0 : LocalizationUtils::getFieldTopRow(cam_pose, config.roiHorizonMargin);
+    slot.startTime = std::chrono::steady_clock::now();
+
+    TaskGraph& graph = *slot.graph.graph;
+    for (TaskGraph::Task task : slot.graph.lowLatencySkipped)
+        graph.setDisabled(task, ultra_low_latency);
+    if (config.frameDeadlineMs <= 0.f) {
+        graph.setDeadline(TaskGraph::Priority::IMPORTANT, std::chrono::steady_clock::time_point::max());
+        graph.setDeadline(TaskGraph::Priority::OPTIONAL, std::chrono::steady_clock::time_point::max());
+    } else {
+        const std::chrono::duration<float, std::milli> deadline(config.frameDeadlineMs);
+        graph.setDeadline(TaskGraph::Priority::IMPORTANT,
+                          slot.startTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(deadline));
+        graph.setDeadline(TaskGraph::Priority::OPTIONAL,
+                          slot.startTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                                   deadline * config.optionalTaskDeadlineShare));
+        graph.setMaxSkippedRuns(config.maxSkippedFrames);
+    }
+    graph.start();
+
+    std::lock_guard<std::mutex> lck(pipelineMtx);
+    if (classifiersBusy) {
+        waitingForClassifiers = &slot.graph;
+        return;
+    }
+    classifiersBusy = true;
+    graph.openGate(slot.graph.gate);
+}
+
+// Runs on the thread that finished the last task of the slot's frame.
+void HTWKVision::frameFinished(FrameSlot& slot) {
+    lastFrameTimeMs.store(
+            std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - slot.startTime).count(),
+            std::memory_order_relaxed);
+    VisionFrameResult& result = results.beginWrite();
+    fillFrameResult(slot, result);
+    cameraStuck.store(result.cameraStuck, std::memory_order_relaxed);
+    results.publish();
+    // Still fine to read, only this function writes.
+    if (slot.result) {
+        slot.result->set_value(result);
+        slot.result.reset();
     }
+
+    std::lock_guard<std::mutex> lck(pipelineMtx);
+    if (waitingForClassifiers == nullptr) {
+        classifiersBusy = false;
+        return;
+    }
+    FrameGraph* next = waitingForClassifiers;
+    waitingForClassifiers = nullptr;
+    next->graph->openGate(next->gate);
+}
+
+void HTWKVision::waitForPipeline() {
+    thread_pool->waitUntil([this]() { return !slots[0].isBusy() && !slots[1].isBusy(); });
+}
+
+void HTWKVision::buildTaskGraph(FrameSlot& slot) {
+    using Priority = TaskGraph::Priority;
+    constexpr Priority REQUIRED = Priority::REQUIRED;
+    constexpr Priority IMPORTANT = Priority::IMPORTANT;
+    constexpr Priority OPTIONAL = Priority::OPTIONAL;
+    FrameGraph& frameGraph = slot.graph;
+    frameGraph.graph = std::make_unique<TaskGraph>(thread_pool);
+    frameGraph.graph->setFinishedCallback([this, &slot]() { frameFinished(slot); });
+    TaskGraph& graph = *frameGraph.graph;
+    // Everything that isn't part of the slot has to wait for the gate.
+    auto gate = graph.addGate({});
+    frameGraph.gate = gate;
+
+    // The ball is required, localization is important and everything else optional.
+    // The integral image is made in the same pass over the image as the scaled images.
+    const bool needsIntegralImage = config.isUpperCam && !config.onlyLocalization;
+    auto imgPrep = graph.addTask(
+            [this, &slot, needsIntegralImage]() {
+                slot.integralImage->setFirstRow(slot.fieldTopRow);
+                slot.imagePyramid->proceed(slot.img, needsIntegralImage ? slot.integralImage.get() : nullptr,
+                                           config.roiMaskNetworkInputs ? slot.fieldTopRow : 0);
+            },
+            {}, REQUIRED, "ImagePyramid");
+    auto planar = graph.addTask([&slot]() { slot.planarImage->proceed(slot.img); }, {}, REQUIRED, "PlanarImage");
+    auto fieldBorder = graph.addTask(
+            [&slot]() { slot.fieldBorderDetector->proceed(slot.fieldBorderImagePreprocessor); }, {imgPrep}, REQUIRED,
+            "FieldBorderDetector");
+    // Compares the frames in the order they are started. The lower camera only scales its image without
+    // onlyLocalization.
+    if (config.isUpperCam || !config.onlyLocalization)
+        frameGraph.stuckCamera = graph.addTask([this, &slot]() { slot.cameraStuck = checkCameraStuck(slot); },
+                                               {imgPrep, gate}, REQUIRED, "StuckCameraCheck");
+    auto fieldColor = graph.addTask([this, &slot]() { fieldColorDetector->proceed(*slot.planarImage); },
+                                    {planar, gate}, IMPORTANT, "FieldColorDetector");
+    auto regions = graph.addTask(
+            [this, &slot]() { regionClassifier->proceed(*slot.planarImage, fieldColorDetector, slot.fieldTopRow); },
+            {fieldColor}, IMPORTANT, "RegionClassifier");
+    // The line detection and the ellipse are skipped with it.
+    frameGraph.lowLatencySkipped.push_back(regions);
+    std::optional<TaskGraph::Task> greenMask;
+    if (slot.greenMask)
+        greenMask = graph.addTask([this, &slot]() { slot.greenMask->proceed(*slot.planarImage, *fieldColorDetector); },
+                                  {fieldColor}, IMPORTANT, "GreenMask");
+    frameGraph.lines = graph.addTask(
+            [this, &slot]() {
+                // LineDetector modifies the LineSegments from RegionClassifier.
+                lineDetector->proceed(
+                        slot.img, regionClassifier->getLineSegments(slot.fieldBorderDetector->getConvexFieldBorder()),
+                        regionClassifier->lineSpacing);
+            },
+            {regions, fieldBorder}, IMPORTANT, "LineDetector");
     if (config.isUpperCam) {
-        if (!ultra_low_latency) {
-            auto ucImgPrepTask = scheduler.addTask([&]() { ucImagePreprocessor->proceed(img); }, {});
-            scheduler.addTask([&]() { ucGoalPostDetector->proceed(cam_pose, ucImagePreprocessor); }, {ucImgPrepTask});
-            scheduler.addTask([&]() { ucCenterCirclePointDetector->proceed(cam_pose, ucImagePreprocessor); },
-                              {ucImgPrepTask});
-
-            if (!config.onlyLocalization) {
-                auto robots =
-                        scheduler.addTask([&]() { ucRobotDetector->proceed(ucImagePreprocessor); }, {ucImgPrepTask});
-                scheduler.addTask([&]() { jerseyDetection->proceed(img); }, {robots});
-            }
-        }
+        frameGraph.ellipse = graph.addTask(
+                [this, &slot]() {
+                    ellipseFitter->proceed(
+                            regionClassifier->getLineSegments(slot.fieldBorderDetector->getConvexFieldBorder()),
+                            slot.img);
+                },
+                {regions, fieldBorder, *frameGraph.lines}, IMPORTANT, "RansacEllipseFitter");
+
+        frameGraph.goalPosts = graph.addTask(
+                [this, &slot]() { ucGoalPostDetector->proceed(slot.camPose, slot.ucImagePreprocessor); },
+                {imgPrep, gate}, IMPORTANT, "UpperCamGoalPostDetector");
+        frameGraph.centerCirclePoints = graph.addTask(
+                [this, &slot]() { ucCenterCirclePointDetector->proceed(slot.camPose, slot.ucImagePreprocessor); },
+                {imgPrep, gate}, IMPORTANT, "UpperCamCenterCirclePointDetector");
+        frameGraph.lowLatencySkipped.push_back(*frameGraph.goalPosts);
+        frameGraph.lowLatencySkipped.push_back(*frameGraph.centerCirclePoints);
 
         if (!config.onlyLocalization) {
-            auto ballHypImgPrep = scheduler.addTask([&]() { ucBallHypImagePreprocessor->proceed(img); }, {});
-            auto ballHypGen = scheduler.addTask(
-                    [&]() { ucBallHypGenerator->proceed(cam_pose, ucBallHypImagePreprocessor); }, {ballHypImgPrep});
-            auto integral = scheduler.addTask([&]() { integralImage->proceed(img); }, {});
-            scheduler.addTask([&]() { ucDirtyCameraDetector->proceed(img, ucBallHypImagePreprocessor); },
-                              {ballHypImgPrep});
-
-            auto hypos = scheduler.addTask(
-                    [&]() {
-                        hypothesesGenerator->proceed(img, fieldBorderDetector->getConvexFieldBorder(), cam_pose,
-                                                     integralImage);
+            frameGraph.robots =
+                    graph.addTask([this, &slot]() { ucRobotDetector->proceed(slot.ucImagePreprocessor); },
+                                  {imgPrep, gate}, OPTIONAL, "UpperCamRobotDetector");
+            // Also skips the jersey detection.
+            frameGraph.lowLatencySkipped.push_back(*frameGraph.robots);
+            // JerseyDetection and UpperCamDirtyCameraDetector use the green tables that fieldColor rebuilds.
+            std::vector<TaskGraph::Task> jerseyDeps{planar, *frameGraph.robots, fieldColor};
+            if (greenMask)
+                jerseyDeps.push_back(*greenMask);
+            graph.addTask([this, &slot]() { jerseyDetection->proceed(*slot.planarImage, slot.greenMask.get()); },
+                          jerseyDeps, OPTIONAL, "JerseyDetection");
+
+            auto ballHypGen = graph.addTask(
+                    [this, &slot]() { ucBallHypGenerator->proceed(slot.camPose, slot.ucBallHypImagePreprocessor); },
+                    {imgPrep, gate}, REQUIRED, "UpperCamBallHypothesesGenerator");
+            std::vector<TaskGraph::Task> dirtyCameraDeps{imgPrep, gate, fieldColor};
+            if (greenMask)
+                dirtyCameraDeps.push_back(*greenMask);
+            frameGraph.dirtyCamera = graph.addTask(
+                    [this, &slot]() {
+                        ucDirtyCameraDetector->proceed(slot.img, slot.ucBallHypImagePreprocessor,
+                                                       slot.greenMask.get());
                     },
-                    {integral, fieldBorder});
-
-            if (!ultra_low_latency) {
-                scheduler.addTask(
-                        [&]() {
-                            auto hypotheses = hypothesesGenerator->getHypotheses();
-                            ucPenaltySpotClassifier->proceed(img, hypotheses);
-                        },
-                        {hypos});
-            }
-
-            scheduler.addTask(
-                    [&]() {
+                    dirtyCameraDeps, OPTIONAL, "UpperCamDirtyCameraDetector");
+
+            auto hypos = graph.addTask(
+                    [this, &slot]() {
+                        hypothesesGenerator->proceed(slot.img, slot.fieldBorderDetector->getConvexFieldBorder(),
+                                                     slot.camPose, slot.integralImage.get());
+                    },
+                    {imgPrep, fieldBorder, gate}, REQUIRED, "HypothesesGenerator");
+
+            frameGraph.penaltySpot = graph.addTask(
+                    [this, &slot]() {
+                        auto hypotheses = hypothesesGenerator->getHypotheses();
+                        ucPenaltySpotClassifier->proceed(*slot.planarImage, hypotheses);
+                    },
+                    {planar, hypos}, OPTIONAL, "UpperCamPenaltySpotClassifier");
+            frameGraph.lowLatencySkipped.push_back(*frameGraph.penaltySpot);
+
+            graph.addTask(
+                    [this, &slot]() {
                         auto hypotheses = hypothesesGenerator->getHypotheses();
                         auto new_hypotheses = ucBallHypGenerator->getHypotheses();
 
                         hypotheses.insert(hypotheses.end(), std::make_move_iterator(new_hypotheses.begin()),
                                           std::make_move_iterator(new_hypotheses.end()));
-                        ballDetectorUpperCamPreClassifier->proceed(img, fieldBorderDetector, hypotheses);
+                        ballDetectorUpperCamPreClassifier->proceed(*slot.planarImage, slot.fieldBorderDetector,
+                                                                   hypotheses);
 
                         auto hypothesesCpy = ballDetectorUpperCamPreClassifier->getAllHypothesesWithProb();
-                        ballDetectorUpperCamPostClassifier->proceed(img, hypothesesCpy, cam_pose);
+                        ballDetectorUpperCamPostClassifier->proceed(slot.img, hypothesesCpy, slot.camPose);
                     },
-                    {hypos, ballHypGen, fieldBorder});
+                    {planar, hypos, ballHypGen, fieldBorder}, REQUIRED, "BallClassifierUpperCam");
         }
     } else {
         if (!config.onlyLocalization) {
-            scheduler.addTask([&]() { obstacleDetectionLowCam->proceed(cam_pose.head_angles.yaw, img); }, {});
-
-            auto imgPrep = scheduler.addTask([&]() { lcImagePreprocessor->proceed(img); }, {});
-            scheduler.addTask([&]() { lcCenterCirclePointDetectorCenter->proceed(cam_pose, lcImagePreprocessor); },
-                              {imgPrep});
-            scheduler.addTask([&]() { lcCenterCirclePointDetectorSide->proceed(cam_pose, lcImagePreprocessor); },
-                              {imgPrep});
-            scheduler.addTask([&]() { lcScrambledCameraDetector->proceed(lcImagePreprocessor); },
-                              {imgPrep});
-            auto hypGenBall = scheduler.addTask([&]() { lcHypGenBall->proceed(cam_pose); }, {imgPrep});
-            auto hypGenPenS = scheduler.addTask([&]() { lcHypGenPenaltySpot->proceed(cam_pose); }, {imgPrep});
-            scheduler.addTask(
-                    [&]() {
-                        objectDetectorLowerCam->proceed(img, cam_pose, lcHypGenBall->getObjectHypotheses(),
+            graph.addTask(
+                    [this, &slot]() { obstacleDetectionLowCam->proceed(slot.camPose.head_angles.yaw, slot.img); },
+                    {gate}, REQUIRED, "LowerCamObstacleDetection");
+            frameGraph.centerCirclePoints = graph.addTask(
+                    [this, &slot]() {
+                        lcCenterCirclePointDetectorCenter->proceed(slot.camPose, slot.lcImagePreprocessor);
+                    },
+                    {imgPrep, gate}, IMPORTANT, "LowerCamCenterCirclePointDetectorCenter");
+            frameGraph.centerCirclePointsSide = graph.addTask(
+                    [this, &slot]() {
+                        lcCenterCirclePointDetectorSide->proceed(slot.camPose, slot.lcImagePreprocessor);
+                    },
+                    {imgPrep, gate}, IMPORTANT, "LowerCamCenterCirclePointDetectorSide");
+            frameGraph.scrambledCamera =
+                    graph.addTask([this, &slot]() { lcScrambledCameraDetector->proceed(slot.lcImagePreprocessor); },
+                                  {imgPrep, gate}, OPTIONAL, "LowerCameraScrambledCameraDetector");
+            auto hypGenBall = graph.addTask(
+                    [this, &slot]() { lcHypGenBall->proceed(slot.camPose, slot.lcImagePreprocessor); },
+                    {imgPrep, gate}, REQUIRED, "ObjectDetectorLowCamHypGenBall");
+            auto hypGenPenS = graph.addTask(
+                    [this, &slot]() { lcHypGenPenaltySpot->proceed(slot.camPose, slot.lcImagePreprocessor); },
+                    {imgPrep, gate}, REQUIRED, "ObjectDetectorLowCamHypGenPenaltySpot");
+            graph.addTask(
+                    [this, &slot]() {
+                        objectDetectorLowerCam->proceed(slot.img, slot.camPose, lcHypGenBall->getObjectHypotheses(),
                                                         lcHypGenPenaltySpot->getObjectHypotheses());
                     },
-                    {hypGenBall, hypGenPenS});
+                    {hypGenBall, hypGenPenS}, REQUIRED, "ObjectDetectorLowCam");
+        }
+    }
+}
+
+void HTWKVision::fillFrameResult(const FrameSlot& slot, VisionFrameResult& result) {
+    const FrameGraph& graph = slot.graph;
+    result = VisionFrameResult();
+    result.frameNumber = ++frameNumber;
+    result.camPose = slot.camPose;
+    result.fieldBorder.assign(slot.fieldBorderDetector->getConvexFieldBorder());
+    result.cameraStuck = graph.ran(graph.stuckCamera) && slot.cameraStuck;
+
+    if (graph.ran(graph.lines)) {
+        for (const LineGroup& group : lineDetector->getLineGroups())
+            result.lines.push_back(group.middle());
+        result.lineCrossings.assign(lineDetector->crossings);
+    }
+    if (graph.ran(graph.ellipse))
+        result.ellipse = ellipseFitter->getEllipse();
+
+    if (config.isUpperCam) {
+        if (graph.ran(graph.goalPosts))
+            result.goalPosts.assign(ucGoalPostDetector->getHypotheses());
+        if (graph.ran(graph.centerCirclePoints))
+            result.centerCirclePoints.assign(ucCenterCirclePointDetector->getHypotheses());
+        if (graph.ran(graph.robots))
+            result.robots.assign(ucRobotDetector->getBoundingBoxes());
+        if (graph.ran(graph.penaltySpot))
+            result.penaltySpot = getPenaltySpot();
+        if (graph.ran(graph.dirtyCamera))
+            result.cameraDirty = ucDirtyCameraDetector->isCameraDirty();
+        if (!config.onlyLocalization)
+            result.ball = getBall();
+    } else if (!config.onlyLocalization) {
+        result.ball = getBall();
+        result.penaltySpot = getPenaltySpot();
+        if (obstacleDetectionLowCam->isDetectionResultValid())
+            result.obstacles.assign(obstacleDetectionLowCam->getDetectionResult());
+        if (graph.ran(graph.centerCirclePoints))
+            result.centerCirclePoints.assign(lcCenterCirclePointDetectorCenter->getHypotheses());
+        if (graph.ran(graph.centerCirclePointsSide)) {
+            for (const ObjectHypothesis& hyp : lcCenterCirclePointDetectorSide->getHypotheses())
+                result.centerCirclePoints.push_back(hyp);
         }
+        if (graph.ran(graph.scrambledCamera))
+            result.cameraScrambled = lcScrambledCameraDetector->isCameraScrambled();
     }
-    scheduler.run();
 }
 
 std::optional<ObjectHypothesis> HTWKVision::getPenaltySpot() const {
@@ -192,9 +485,9 @@ std::optional<ObjectHypothesis> HTWKVision::getBall() const {
     return ballDetector->getBall();
 }
 
-bool HTWKVision::isCameraStuck() {
+bool HTWKVision::checkCameraStuck(const FrameSlot& slot) {
     EASY_FUNCTION();
-    const auto& ref_data = (config.isUpperCam ? ucImagePreprocessor : lcImagePreprocessor)->getScaledImage();
+    const auto& ref_data = (config.isUpperCam ? slot.ucImagePreprocessor : slot.lcImagePreprocessor)->getScaledImage();
 
     if (stuckCameraReferenceImage.empty()) {
         stuckCameraReferenceImage = ref_data;
@@ -8,9 +8,11 @@
 #include <ball_pre_classifier_upper_cam.h>
 #include <field_border_detector.h>
 #include <field_color_detector.h>
+#include <green_mask.h>
 #include <htwk_vision_config.h>
 #include <hypotheses_generator.h>
 #include <image_preprocessor.h>
+#include <image_pyramid.h>
 #include <integral_image.h>
 #include <jersey_detection.h>
 #include <lc_centercirclepoints_detector.h>
@@ -21,6 +23,7 @@
 #include <object_detector_lowercam.h>
 #include <object_detector_lowercam_hyp_gen.h>
 #include <penaltyspot_detector.h>
+#include <planar_image.h>
 #include <ransac_ellipse_fitter.h>
 #include <region_classifier.h>
 #include <uc_ball_hyp_gen.h>
@@ -28,15 +31,22 @@
 #include <uc_goalpost_detector.h>
 #include <uc_penaltyspot_classifier.h>
 #include <uc_robot_detector.h>
+#include <triple_buffer.h>
 #include <uc_dirty_camera_detector.h>
+#include <vision_frame_result.h>
 
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <ctime>
 #include <fstream>
+#include <future>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <vector>
 
 namespace htwk {
@@ -66,7 +76,87 @@ private:
     HtwkVisionConfig config;
     ThreadPool* thread_pool;
 
+    // Scaled image of the previous frame, only used by the stuck camera task. It runs behind the gate, so the frames
+    // use it one after the other.
     std::vector<float> stuckCameraReferenceImage;
+    std::atomic<bool> cameraStuck{false};
+
+    // The task graph is built once, a frame only sets its input and runs it. The gate holds back everything after the
+    // early stages until the previous frame is finished. The other tasks are the ones that may be skipped, their
+    // results are left empty in the VisionFrameResult then.
+    struct FrameGraph {
+        std::unique_ptr<TaskGraph> graph;
+        TaskGraph::Task gate = 0;
+        std::optional<TaskGraph::Task> lines;
+        std::optional<TaskGraph::Task> ellipse;
+        std::optional<TaskGraph::Task> goalPosts;
+        std::optional<TaskGraph::Task> centerCirclePoints;
+        std::optional<TaskGraph::Task> centerCirclePointsSide;
+        std::optional<TaskGraph::Task> robots;
+        std::optional<TaskGraph::Task> penaltySpot;
+        std::optional<TaskGraph::Task> dirtyCamera;
+        std::optional<TaskGraph::Task> scrambledCamera;
+        std::optional<TaskGraph::Task> stuckCamera;
+        // Skipped with ultra_low_latency, the tasks that depend on them are skipped as well.
+        std::vector<TaskGraph::Task> lowLatencySkipped;
+
+        bool ran(const std::optional<TaskGraph::Task>& task) const {
+            return task && !graph->wasSkipped(*task);
+        }
+    };
+
+    // The early stages of a frame (preprocessing, integral image, field border) and the input. proceedAsync()
+    // alternates between two slots, so the next frame can be preprocessed while the classifiers still work on the
+    // previous one. Slot 0 is the one in the public members, proceed() only uses this one.
+    struct FrameSlot {
+        std::shared_ptr<FieldBorderDetector> fieldBorderDetector;
+        std::shared_ptr<IntegralImage> integralImage;
+        // Y, Cb and Cr of the image in separate planes for the detectors that look at single pixels.
+        std::shared_ptr<PlanarImage> planarImage;
+        // Only with HtwkVisionConfig::greenMaskScale.
+        std::shared_ptr<GreenMask> greenMask;
+        // Scales the image once for all preprocessors below that the camera uses, the others never run.
+        std::shared_ptr<ImagePyramid> imagePyramid;
+        std::shared_ptr<ImagePreprocessor> fieldBorderImagePreprocessor;
+        std::shared_ptr<ImagePreprocessor> ucBallHypImagePreprocessor;
+        std::shared_ptr<ImagePreprocessor> ucImagePreprocessor;
+        std::shared_ptr<ImagePreprocessor> lcImagePreprocessor;
+
+        FrameGraph graph;
+
+        uint8_t* img = nullptr;
+        CamPose camPose;
+        // The rows above can't show the field, see HtwkVisionConfig::roiHorizonMargin.
+        int fieldTopRow = 0;
+        bool cameraStuck = false;
+        std::chrono::steady_clock::time_point startTime;
+        std::optional<std::promise<VisionFrameResult>> result;
+
+        bool isBusy() const {
+            return graph.graph->isRunning();
+        }
+    };
+    FrameSlot slots[2];
+    int nextSlot = 0;
+
+    std::mutex pipelineMtx;
+    bool classifiersBusy = false;
+    FrameGraph* waitingForClassifiers = nullptr;
+
+    std::atomic<float> lastFrameTimeMs{0.f};
+
+    // Only written by frameFinished(), the frames finish one after the other.
+    TripleBuffer<VisionFrameResult> results;
+    uint64_t frameNumber = 0;
+
+    void createFrameSlot(FrameSlot& slot);
+    void buildTaskGraph(FrameSlot& slot);
+    void setSharedTensorSinks(FrameSlot& slot, bool enabled);
+    void startFrame(FrameSlot& slot, uint8_t* img, const CamPose& cam_pose, bool ultra_low_latency);
+    void frameFinished(FrameSlot& slot);
+    void waitForPipeline();
+    void fillFrameResult(const FrameSlot& slot, VisionFrameResult& result);
+    bool checkCameraStuck(const FrameSlot& slot);
 
 public:
     FieldColorDetector* fieldColorDetector = nullptr;
@@ -112,8 +202,36 @@ public:
     HTWKVision& operator=(HTWKVision&&) = delete;
     ~HTWKVision();
 
+    // Tasks that aren't needed for the ball are skipped when they would miss HtwkVisionConfig::frameDeadlineMs (if it
+    // is set). ultra_low_latency skips the line, goal post, robot and penalty spot detection, the camera checks and the
+    // lower camera center circle points still run.
     void proceed(uint8_t* img, CamPose& cam_pose, bool ultra_low_latency = false);
 
+    // proceed() split in two, so several instances can work on the same pool at the same time.
+    void startProceed(uint8_t* img, CamPose& cam_pose, bool ultra_low_latency = false);
+    void waitForProceed();
+
+    // Returns as soon as the frame is queued, only blocks if two frames are already in flight. The image has to stay
+    // valid until the future is ready. The public detectors must not be read while frames are in flight, use the
+    // result instead.
+    std::future<VisionFrameResult> proceedAsync(uint8_t* img, const CamPose& cam_pose, bool ultra_low_latency = false);
+
+    // Result of the last finished frame. Never blocks the vision, can be called from any thread.
+    VisionFrameResult getLatestResult() const {
+        return results.read();
+    }
+
+    // Records the tasks of the following frames, nullptr stops recording. Only call it while no frame is in flight.
+    void setTaskTrace(TaskTrace* trace);
+
+    // The tasks of this instance go ahead of all other pool work. Only call it while no frame is in flight.
+    void setUrgent(bool urgent);
+
+    // Time from the start of the last finished frame until all of its tasks were done.
+    float getLastFrameTimeMs() const {
+        return lastFrameTimeMs.load(std::memory_order_relaxed);
+    }
+
     std::optional<ObjectHypothesis> getPenaltySpot() const;
     std::optional<ObjectHypothesis> getBall() const;
 
@@ -127,7 +245,10 @@ public:
         return lutCr;
     }
 
-    bool isCameraStuck();
+    // Whether the scaled image of the last finished frame is nearly the same as the one of the frame before.
+    bool isCameraStuck() const {
+        return cameraStuck.load(std::memory_order_relaxed);
+    }
 };
 
 }  // namespace htwk
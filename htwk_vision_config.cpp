@@ -12,4 +12,9 @@ HtwkVisionConfig::HtwkVisionConfig() {
     tflitePath = TFLiteExecuter::getTFliteModelPath();
 }
 
+void HtwkVisionConfig::useRobotDefaults() {
+    frameDeadlineMs = robotFrameDeadlineMs;
+    roiHorizonMargin = robotRoiHorizonMargin;
+}
+
 }
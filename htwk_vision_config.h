@@ -113,6 +113,10 @@ struct HtwkVisionConfig {
 
     int ballPreClassifierUpperCamThreads = 2;
 
+    // Size of the threadpool that all neural networks with more than one thread share, across both cameras. It is
+    // limited to the size of the vision ThreadPool. Those networks run one at a time.
+    int nnSharedThreads = 2;
+
     bool isUpperCam = true;
 
     // Path where all tflite models are stored.
@@ -140,6 +144,44 @@ struct HtwkVisionConfig {
 
     bool onlyLocalization = false;
 
+    // Time in which a frame should be processed, everything that isn't needed for the ball is skipped if it would end
+    // later. 0 processes every frame completely, so the results don't depend on timing. The robot uses
+    // robotFrameDeadlineMs, see useRobotDefaults().
+    float frameDeadlineMs = 0.f;
+    // The cameras deliver 30 frames per second.
+    static constexpr float robotFrameDeadlineMs = 33.3f;
+    // Optional tasks (robots, penalty spot, camera checks) already give way if they would end after this share of the
+    // deadline, localization only at the deadline itself.
+    float optionalTaskDeadlineShare = 0.75f;
+    // A skipped task runs anyway after it was skipped this many frames in a row.
+    int maxSkippedFrames = 5;
+
+    // The image pyramid and the integral image are made by this many pool tasks, each on a horizontal band of the
+    // image. Limited to the size of the vision ThreadPool.
+    int imagePyramidBands = 4;
+    // Same for the scanlines of the region classifier.
+    int regionClassifierBands = 4;
+
+    // Rows more than this far above the horizon can't show the field, the integral image and the region classifier
+    // skip them. -1 processes the whole image, so the results don't depend on the camera pose. The robot uses
+    // robotRoiHorizonMargin, see useRobotDefaults(). The patches of the ball and penalty spot classifiers aren't
+    // clipped, they are only sampled around hypotheses and the pre-classifier drops the ones above the field border.
+    int roiHorizonMargin = -1;
+    static constexpr int robotRoiHorizonMargin = 32;
+    // Also fill those rows of the network inputs with 0 instead of scaling them. The networks were trained on whole
+    // images, so this is off unless a model was trained with the mask.
+    bool roiMaskNetworkInputs = false;
+
+    // With more than 1 (at most 8) phases FieldColorDetector only samples every fieldColorPhases-th of its sample rows
+    // per frame and keeps its histograms over frames. The green cube is only estimated again if the field color moved
+    // more than fieldColorDriftThreshold in a channel.
+    int fieldColorPhases = 1;
+    int fieldColorDriftThreshold = 2;
+
+    // The field color classification of every pixel (1) or of every second pixel of every second row (2) as a bit
+    // mask for the dirty camera detector and the jersey detection. With 0 they test their pixels themselves.
+    int greenMaskScale = 0;
+
     size_t imageMemorySize() const {
         return 2 * width * height + 16 /* SSE alignment */;
     }
@@ -151,6 +193,10 @@ struct HtwkVisionConfig {
 #endif
 
     HtwkVisionConfig();
+
+    // Settings for the robot, where a frame has to be done before the next one arrives and the camera pose is known.
+    // Results then depend on timing and on the pose.
+    void useRobotDefaults();
 };
 
 }  // namespace htwk
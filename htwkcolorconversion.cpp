@@ -1,72 +1,274 @@
 #include "htwkcolorconversion.h"
 
+#include <algorithm>
+
+#include <async.h>
+#include <immintrin.h>
+
 namespace htwk {
 namespace image  {
 
-void ColorConversion::rgbaToYuv422(uint8_t *out, const std::vector<uint8_t> &in, const uint32_t width, const uint32_t height) {
-    const uint8_t* data = in.data();
+namespace {
 
-    for (uint32_t y = 0; y < height; y++) {
-        for (uint32_t x = 0; x < width; x+=2) {
-            const int start = x * 4 + y * width * 4;
-            const float r1 = data[start];
-            const float g1 = data[start+1];
-            const float b1 = data[start+2];
+// Q15 coefficients of the float formulas for RGB -> YCbCr, rounded so that white still gets Y = 255.
+constexpr int16_t yR = 9798, yG = 19235, yB = 3736;
+constexpr int16_t cbR = -5538, cbG = -10846, cbB = 16351;
+constexpr int16_t crR = 16319, crG = -13730, crB = -2664;
+constexpr int rgbShift = 15;
 
-            const float r2 = data[start+4];
-            const float g2 = data[start+5];
-            const float b2 = data[start+6];
+// Q14 coefficients for YCbCr -> RGB.
+constexpr int16_t rCr = 22970, gCb = -5636, gCr = -11698, bCb = 29032;
+constexpr int yuvShift = 14;
 
-            const int outIdx = x * 2 + y * width * 2;
+inline uint8_t clamp8(int v) {
+    return (uint8_t)std::min(std::max(v, 0), 255);
+}
 
-            /* Y1  */ out[outIdx]   = (uint8_t) ( 0.299f * r1 + 0.587f * g1 + 0.114f  * b1);
-            /* Cb1 */ out[outIdx+1] = (uint8_t) (-0.169f * r1 - 0.331f * g1 + 0.499f  * b1 + 128);
-            /* Y2  */ out[outIdx+2] = (uint8_t) ( 0.299f * r2 + 0.587f * g2 + 0.114f  * b2);
-            /* Cr1 */ out[outIdx+3] = (uint8_t) ( 0.498f * r2 - 0.419f * g2 - 0.0813f * b2 + 128);
-        }
+// Y1 Cb Y2 Cr: Cb is taken from the first pixel of the pair, Cr from the second one.
+void rgbaToYuv422Scalar(uint8_t *out, const uint8_t *in, uint32_t begin, uint32_t end, bool alphaFirst) {
+    const uint8_t *data = in + (alphaFirst ? 1 : 0);
+    for (uint32_t i = begin; i < end; i += 2) {
+        const uint8_t *p1 = data + i * 4;
+        const uint8_t *p2 = p1 + 4;
+        out[i * 2]     = clamp8((yR * p1[0] + yG * p1[1] + yB * p1[2]) >> rgbShift);
+        out[i * 2 + 1] = clamp8((cbR * p1[0] + cbG * p1[1] + cbB * p1[2] + (128 << rgbShift)) >> rgbShift);
+        out[i * 2 + 2] = clamp8((yR * p2[0] + yG * p2[1] + yB * p2[2]) >> rgbShift);
+        out[i * 2 + 3] = clamp8((crR * p2[0] + crG * p2[1] + crB * p2[2] + (128 << rgbShift)) >> rgbShift);
     }
 }
 
-void ColorConversion::argbToYuv422(uint8_t *out, uint8_t *data, const uint32_t width, const uint32_t height) {
-    for (uint32_t y = 0; y < height; y++) {
-        for (uint32_t x = 0; x < width; x+=2) {
-            const int start = x * 4 + y * width * 4;
-            const float r1 = data[start+1];
-            const float g1 = data[start+2];
-            const float b1 = data[start+3];
-
-            const float r2 = data[start+5];
-            const float g2 = data[start+6];
-            const float b2 = data[start+7];
-
-            const int outIdx = x * 2 + y * width * 2;
-
-            /* Y1  */ out[outIdx]   = (uint8_t) ( 0.299f * r1 + 0.587f * g1 + 0.114f  * b1);
-            /* Cb1 */ out[outIdx+1] = (uint8_t) (-0.169f * r1 - 0.331f * g1 + 0.499f  * b1 + 128);
-            /* Y2  */ out[outIdx+2] = (uint8_t) ( 0.299f * r2 + 0.587f * g2 + 0.114f  * b2);
-            /* Cr1 */ out[outIdx+3] = (uint8_t) ( 0.498f * r2 - 0.419f * g2 - 0.0813f * b2 + 128);
+inline void yuvToRgba(uint8_t *out, int y, int cb, int cr) {
+    y <<= yuvShift;
+    cb -= 128;
+    cr -= 128;
+    out[0] = clamp8((y + rCr * cr + (2 << yuvShift)) >> yuvShift);
+    out[1] = clamp8((y + gCb * cb + gCr * cr) >> yuvShift);
+    out[2] = clamp8((y + bCb * cb + (2 << yuvShift)) >> yuvShift);
+    out[3] = 255;
+}
+
+// Pixels [begin, end) of one row. Like it always was, an even pixel gets the Cr of the previous pair (the first pair
+// of the row uses its own) and an odd pixel the Cr of its own pair.
+void yuv422ToRgbaScalar(uint8_t *out, const uint8_t *row, uint32_t begin, uint32_t end) {
+    for (uint32_t px = begin; px < end; px++) {
+        const uint32_t pair = (px >> 1) << 2;
+        const uint32_t crPair = (px & 1) || px == 0 ? pair : pair - 4;
+        yuvToRgba(out + px * 4, row[px * 2], row[pair + 1], row[crPair + 3]);
+    }
+}
+
+// Lanes with (Y1 Cb Y2 Cr) of two pixels -> (Cb - 128, Cr - 128) as 16 bit pairs for _mm_madd_epi16. crPairs has
+// the pairs to take Cr from.
+inline __m128i chroma(__m128i pairs, __m128i crPairs) {
+    const __m128i cb = _mm_and_si128(_mm_srli_epi32(pairs, 8), _mm_set1_epi32(0xff));
+    const __m128i cr = _mm_slli_epi32(_mm_srli_epi32(crPairs, 24), 16);
+    return _mm_sub_epi16(_mm_or_si128(cb, cr), _mm_set1_epi16(128));
+}
+
+inline __m128i channel(__m128i y, __m128i c, __m128i coef, __m128i offset) {
+    return _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(y, _mm_madd_epi16(c, coef)), offset), yuvShift);
+}
+
+// 32 bit values of the even and the odd pixels -> 16 bit values in pixel order.
+inline __m128i interleave(__m128i even, __m128i odd) {
+    return _mm_packs_epi32(_mm_unpacklo_epi32(even, odd), _mm_unpackhi_epi32(even, odd));
+}
+
+void yuv422ToRgbaSse2(uint8_t *out, const uint8_t *in, uint32_t width, uint32_t height) {
+    const __m128i lowByte = _mm_set1_epi32(0xff);
+    const __m128i coefR = _mm_setr_epi16(0, rCr, 0, rCr, 0, rCr, 0, rCr);
+    const __m128i coefG = _mm_setr_epi16(gCb, gCr, gCb, gCr, gCb, gCr, gCb, gCr);
+    const __m128i coefB = _mm_setr_epi16(bCb, 0, bCb, 0, bCb, 0, bCb, 0);
+    const __m128i offset = _mm_set1_epi32(2 << yuvShift);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha = _mm_set1_epi16(255);
+    for (uint32_t py = 0; py < height; py++) {
+        const uint8_t *row = in + py * width * 2;
+        uint8_t *outRow = out + py * width * 4;
+        // The first pair has no previous Cr, the vector loop starts behind it.
+        yuv422ToRgbaScalar(outRow, row, 0, std::min(2u, width));
+        uint32_t px = 2;
+        for (; px + 8 <= width; px += 8) {
+            const __m128i pairs = _mm_loadu_si128((const __m128i*)(row + px * 2));
+            const __m128i prevPairs = _mm_loadu_si128((const __m128i*)(row + px * 2 - 4));
+            const __m128i yEven = _mm_slli_epi32(_mm_and_si128(pairs, lowByte), yuvShift);
+            const __m128i yOdd = _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(pairs, 16), lowByte), yuvShift);
+            const __m128i cEven = chroma(pairs, prevPairs);
+            const __m128i cOdd = chroma(pairs, pairs);
+            const __m128i r = interleave(channel(yEven, cEven, coefR, offset), channel(yOdd, cOdd, coefR, offset));
+            const __m128i g = interleave(channel(yEven, cEven, coefG, zero), channel(yOdd, cOdd, coefG, zero));
+            const __m128i b = interleave(channel(yEven, cEven, coefB, offset), channel(yOdd, cOdd, coefB, offset));
+            const __m128i rb = _mm_packus_epi16(r, b);
+            const __m128i ga = _mm_packus_epi16(g, alpha);
+            const __m128i rg = _mm_unpacklo_epi8(rb, ga);
+            const __m128i ba = _mm_unpackhi_epi8(rb, ga);
+            _mm_storeu_si128((__m128i*)(outRow + px * 4), _mm_unpacklo_epi16(rg, ba));
+            _mm_storeu_si128((__m128i*)(outRow + px * 4 + 16), _mm_unpackhi_epi16(rg, ba));
         }
+        yuv422ToRgbaScalar(outRow, row, px, width);
     }
 }
 
-void ColorConversion::yuv422ToRgba(std::vector<uint8_t> &out, const uint8_t *const in, const uint32_t width, const uint32_t height) {
-    for(uint32_t py=0;py<height;py++){
-        int cbLast=in[(0+py*width)*2+1]&255;
-        int crLast=in[(0+py*width)*2+3]&255;
-        for(uint32_t px=0;px<width;px++){
-            int y=in[(px+py*width)*2]&255;
-            if((px&1)==0){
-                cbLast=in[(px+py*width)*2+1]&255;
-            }else{
-                crLast=in[(px+py*width)*2+1]&255;
-            }
-            int cb=cbLast;
-            int cr=crLast;
-            out[px * 4 + py * width * 4] = clip(y+1.402f*(cr-128)+2);
-            out[1 + px * 4 + py * width * 4] = clip(y-0.344f*(cb-128)-0.714f*(cr-128));
-            out[2 + px * 4 + py * width * 4] = clip(y+1.772f*(cb-128)+2);
+__attribute__((target("avx2"))) inline __m256i chromaAvx2(__m256i pairs, __m256i crPairs) {
+    const __m256i cb = _mm256_and_si256(_mm256_srli_epi32(pairs, 8), _mm256_set1_epi32(0xff));
+    const __m256i cr = _mm256_slli_epi32(_mm256_srli_epi32(crPairs, 24), 16);
+    return _mm256_sub_epi16(_mm256_or_si256(cb, cr), _mm256_set1_epi16(128));
+}
+
+__attribute__((target("avx2"))) inline __m256i channelAvx2(__m256i y, __m256i c, __m256i coef, __m256i offset) {
+    return _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(y, _mm256_madd_epi16(c, coef)), offset), yuvShift);
+}
+
+__attribute__((target("avx2"))) inline __m256i interleaveAvx2(__m256i even, __m256i odd) {
+    return _mm256_packs_epi32(_mm256_unpacklo_epi32(even, odd), _mm256_unpackhi_epi32(even, odd));
+}
+
+// Same as the SSE2 kernel, every 128 bit lane does 8 pixels.
+__attribute__((target("avx2"))) void yuv422ToRgbaAvx2(uint8_t *out, const uint8_t *in, uint32_t width,
+                                                      uint32_t height) {
+    const __m256i lowByte = _mm256_set1_epi32(0xff);
+    const __m256i coefR = _mm256_broadcastsi128_si256(_mm_setr_epi16(0, rCr, 0, rCr, 0, rCr, 0, rCr));
+    const __m256i coefG = _mm256_broadcastsi128_si256(_mm_setr_epi16(gCb, gCr, gCb, gCr, gCb, gCr, gCb, gCr));
+    const __m256i coefB = _mm256_broadcastsi128_si256(_mm_setr_epi16(bCb, 0, bCb, 0, bCb, 0, bCb, 0));
+    const __m256i offset = _mm256_set1_epi32(2 << yuvShift);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alpha = _mm256_set1_epi16(255);
+    for (uint32_t py = 0; py < height; py++) {
+        const uint8_t *row = in + py * width * 2;
+        uint8_t *outRow = out + py * width * 4;
+        yuv422ToRgbaScalar(outRow, row, 0, std::min(2u, width));
+        uint32_t px = 2;
+        for (; px + 16 <= width; px += 16) {
+            const __m256i pairs = _mm256_loadu_si256((const __m256i*)(row + px * 2));
+            const __m256i prevPairs = _mm256_loadu_si256((const __m256i*)(row + px * 2 - 4));
+            const __m256i yEven = _mm256_slli_epi32(_mm256_and_si256(pairs, lowByte), yuvShift);
+            const __m256i yOdd =
+                    _mm256_slli_epi32(_mm256_and_si256(_mm256_srli_epi32(pairs, 16), lowByte), yuvShift);
+            const __m256i cEven = chromaAvx2(pairs, prevPairs);
+            const __m256i cOdd = chromaAvx2(pairs, pairs);
+            const __m256i r = interleaveAvx2(channelAvx2(yEven, cEven, coefR, offset),
+                                             channelAvx2(yOdd, cOdd, coefR, offset));
+            const __m256i g = interleaveAvx2(channelAvx2(yEven, cEven, coefG, zero),
+                                             channelAvx2(yOdd, cOdd, coefG, zero));
+            const __m256i b = interleaveAvx2(channelAvx2(yEven, cEven, coefB, offset),
+                                             channelAvx2(yOdd, cOdd, coefB, offset));
+            const __m256i rb = _mm256_packus_epi16(r, b);
+            const __m256i ga = _mm256_packus_epi16(g, alpha);
+            const __m256i rg = _mm256_unpacklo_epi8(rb, ga);
+            const __m256i ba = _mm256_unpackhi_epi8(rb, ga);
+            // Pixels 0-3 and 8-11, 4-7 and 12-15.
+            const __m256i lo = _mm256_unpacklo_epi16(rg, ba);
+            const __m256i hi = _mm256_unpackhi_epi16(rg, ba);
+            _mm256_storeu_si256((__m256i*)(outRow + px * 4), _mm256_permute2x128_si256(lo, hi, 0x20));
+            _mm256_storeu_si256((__m256i*)(outRow + px * 4 + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
         }
+        yuv422ToRgbaScalar(outRow, row, px, width);
+    }
+}
+
+// Sums the two 32 bit halves of _mm_madd_epi16 results per pixel: (a0 a1 a2 a3 b0 b1 b2 b3) -> (a0+a1 a2+a3 ...).
+inline __m128i pixelSums(__m128i a, __m128i b) {
+    a = _mm_add_epi32(a, _mm_srli_epi64(a, 32));
+    b = _mm_add_epi32(b, _mm_srli_epi64(b, 32));
+    return _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+// 4 pixels -> (Y1 Cb Y2 Cr) * 2 as 16 bit values.
+inline __m128i rgbaToYuv4(__m128i rgba, __m128i coefY, __m128i coefC) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lo = _mm_unpacklo_epi8(rgba, zero);
+    const __m128i hi = _mm_unpackhi_epi8(rgba, zero);
+    const __m128i y = _mm_srai_epi32(pixelSums(_mm_madd_epi16(lo, coefY), _mm_madd_epi16(hi, coefY)), rgbShift);
+    const __m128i c = _mm_srai_epi32(_mm_add_epi32(pixelSums(_mm_madd_epi16(lo, coefC), _mm_madd_epi16(hi, coefC)),
+                                                   _mm_set1_epi32(128 << rgbShift)),
+                                     rgbShift);
+    return _mm_or_si128(y, _mm_slli_epi32(c, 16));
+}
+
+void rgbaToYuv422Sse2(uint8_t *out, const uint8_t *in, uint32_t numPixels, bool alphaFirst) {
+    const __m128i coefY = alphaFirst ? _mm_setr_epi16(0, yR, yG, yB, 0, yR, yG, yB)
+                                     : _mm_setr_epi16(yR, yG, yB, 0, yR, yG, yB, 0);
+    const __m128i coefC = alphaFirst ? _mm_setr_epi16(0, cbR, cbG, cbB, 0, crR, crG, crB)
+                                     : _mm_setr_epi16(cbR, cbG, cbB, 0, crR, crG, crB, 0);
+    uint32_t i = 0;
+    for (; i + 8 <= numPixels; i += 8) {
+        const __m128i p0 = _mm_loadu_si128((const __m128i*)(in + i * 4));
+        const __m128i p1 = _mm_loadu_si128((const __m128i*)(in + i * 4 + 16));
+        _mm_storeu_si128((__m128i*)(out + i * 2),
+                         _mm_packus_epi16(rgbaToYuv4(p0, coefY, coefC), rgbaToYuv4(p1, coefY, coefC)));
     }
+    rgbaToYuv422Scalar(out, in, i, numPixels, alphaFirst);
+}
+
+__attribute__((target("avx2"))) inline __m256i pixelSumsAvx2(__m256i a, __m256i b) {
+    a = _mm256_add_epi32(a, _mm256_srli_epi64(a, 32));
+    b = _mm256_add_epi32(b, _mm256_srli_epi64(b, 32));
+    return _mm256_castps_si256(
+            _mm256_shuffle_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b), _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+__attribute__((target("avx2"))) inline __m256i rgbaToYuv8(__m256i rgba, __m256i coefY, __m256i coefC) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i lo = _mm256_unpacklo_epi8(rgba, zero);
+    const __m256i hi = _mm256_unpackhi_epi8(rgba, zero);
+    const __m256i y =
+            _mm256_srai_epi32(pixelSumsAvx2(_mm256_madd_epi16(lo, coefY), _mm256_madd_epi16(hi, coefY)), rgbShift);
+    const __m256i c = _mm256_srai_epi32(
+            _mm256_add_epi32(pixelSumsAvx2(_mm256_madd_epi16(lo, coefC), _mm256_madd_epi16(hi, coefC)),
+                             _mm256_set1_epi32(128 << rgbShift)),
+            rgbShift);
+    return _mm256_or_si256(y, _mm256_slli_epi32(c, 16));
+}
+
+__attribute__((target("avx2"))) void rgbaToYuv422Avx2(uint8_t *out, const uint8_t *in, uint32_t numPixels,
+                                                      bool alphaFirst) {
+    const __m256i coefY = _mm256_broadcastsi128_si256(alphaFirst ? _mm_setr_epi16(0, yR, yG, yB, 0, yR, yG, yB)
+                                                                 : _mm_setr_epi16(yR, yG, yB, 0, yR, yG, yB, 0));
+    const __m256i coefC = _mm256_broadcastsi128_si256(alphaFirst ? _mm_setr_epi16(0, cbR, cbG, cbB, 0, crR, crG, crB)
+                                                                 : _mm_setr_epi16(cbR, cbG, cbB, 0, crR, crG, crB, 0));
+    uint32_t i = 0;
+    for (; i + 16 <= numPixels; i += 16) {
+        const __m256i p0 = _mm256_loadu_si256((const __m256i*)(in + i * 4));
+        const __m256i p1 = _mm256_loadu_si256((const __m256i*)(in + i * 4 + 32));
+        // Lanes hold pixels 0-3 and 8-11, 4-7 and 12-15.
+        const __m256i yuv = _mm256_packus_epi16(rgbaToYuv8(p0, coefY, coefC), rgbaToYuv8(p1, coefY, coefC));
+        _mm256_storeu_si256((__m256i*)(out + i * 2), _mm256_permute4x64_epi64(yuv, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+    rgbaToYuv422Scalar(out, in, i, numPixels, alphaFirst);
+}
+
+}  // namespace
+
+ColorConversion::RgbaToYuv422Kernel ColorConversion::rgbaToYuv422Kernel() {
+    static const RgbaToYuv422Kernel kernel = []() -> RgbaToYuv422Kernel {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return rgbaToYuv422Avx2;
+        return rgbaToYuv422Sse2;
+    }();
+    return kernel;
+}
+
+ColorConversion::Yuv422ToRgbaKernel ColorConversion::yuv422ToRgbaKernel() {
+    static const Yuv422ToRgbaKernel kernel = []() -> Yuv422ToRgbaKernel {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return yuv422ToRgbaAvx2;
+        return yuv422ToRgbaSse2;
+    }();
+    return kernel;
+}
+
+void ColorConversion::rgbaToYuv422(uint8_t *out, const std::vector<uint8_t> &in, const uint32_t width, const uint32_t height) {
+    rgbaToYuv422Kernel()(out, in.data(), width * height, false);
+}
+
+void ColorConversion::argbToYuv422(uint8_t *out, uint8_t *data, const uint32_t width, const uint32_t height) {
+    rgbaToYuv422Kernel()(out, data, width * height, true);
+}
+
+void ColorConversion::yuv422ToRgba(std::vector<uint8_t> &out, const uint8_t *const in, const uint32_t width, const uint32_t height) {
+    yuv422ToRgbaKernel()(out.data(), in, width, height);
 }
 
 void ColorConversion::yuv422ToRgba(std::vector<uint8_t> &out, std::vector<uint8_t> &in, const uint32_t width, const uint32_t height) {
@@ -74,6 +276,23 @@ void ColorConversion::yuv422ToRgba(std::vector<uint8_t> &out, std::vector<uint8_
     yuv422ToRgba(out, inArray, width, height);
 }
 
+void ColorConversion::yuv422ToRgba(std::vector<std::vector<uint8_t>> &out, const std::vector<const uint8_t*> &in,
+                                   const uint32_t width, const uint32_t height, ThreadPool* threadPool) {
+    out.resize(in.size());
+    for (std::vector<uint8_t>& rgba : out)
+        rgba.resize(width * height * 4);
+    if (threadPool == nullptr) {
+        for (size_t i = 0; i < in.size(); i++)
+            yuv422ToRgba(out[i], in[i], width, height);
+        return;
+    }
+    TaskGraph graph(threadPool);
+    for (size_t i = 0; i < in.size(); i++)
+        graph.addTask([&out, &in, i, width, height]() { yuv422ToRgba(out[i], in[i], width, height); }, {},
+                      TaskGraph::Priority::REQUIRED, "Yuv422ToRgba");
+    graph.run();
+}
+
 void ColorConversion::yuv422ToGrey(std::vector<uint8_t> &out, const uint8_t *const in, const uint32_t width, const uint32_t height) {
     for(uint32_t py=0;py<height;py++){
         for(uint32_t px=0;px<width;px++){
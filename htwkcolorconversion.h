@@ -5,11 +5,16 @@
 
 #include <vector>
 
+class ThreadPool;
+
 namespace htwk {
 namespace image  {
 
 /**
  * @brief The ColorConversion class provides util functions to convert from RGBA to YUV422 and back.
+ *
+ * The image conversions use fixed point math with SSE2 or AVX2, whatever the CPU supports. All kernels give
+ * bit-identical results, which can differ by one from the float formulas below. yuv422ToRgba() sets alpha to 255.
  */
 class ColorConversion
 {
@@ -20,12 +25,21 @@ private:
         return (uint8_t)d;
     }
 
+    using RgbaToYuv422Kernel = void (*)(uint8_t* out, const uint8_t* in, uint32_t numPixels, bool alphaFirst);
+    using Yuv422ToRgbaKernel = void (*)(uint8_t* out, const uint8_t* in, uint32_t width, uint32_t height);
+    static RgbaToYuv422Kernel rgbaToYuv422Kernel();
+    static Yuv422ToRgbaKernel yuv422ToRgbaKernel();
+
 public:
     static void rgbaToYuv422(uint8_t *out, const std::vector<uint8_t> &in, uint32_t width, uint32_t height);
     static void argbToYuv422(uint8_t *out, uint8_t *data, uint32_t width, uint32_t height);
 
     static void yuv422ToRgba(std::vector<uint8_t> &out, const uint8_t *in, uint32_t width, uint32_t height);
     static void yuv422ToRgba(std::vector<uint8_t> &out, std::vector<uint8_t> &in, uint32_t width, uint32_t height);
+    // Converts whole batches of images (e.g. all frames of a log) on the pool, one task per image. out is resized to
+    // the number of images. Without a pool the images are converted one after another.
+    static void yuv422ToRgba(std::vector<std::vector<uint8_t>> &out, const std::vector<const uint8_t*> &in,
+                             uint32_t width, uint32_t height, ThreadPool* threadPool);
     static void yuv422ToGrey(std::vector<uint8_t> &out, const uint8_t *in, uint32_t width, const uint32_t height);
 
     static uint32_t yuv422ToRgba(int32_t y, int32_t cr, int32_t cb) {
@@ -1,9 +1,11 @@
 #include "image_preprocessor.h"
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
 #include <easy/profiler.h>
-#include <emmintrin.h>
+#include <immintrin.h>
 
 namespace htwk {
 
@@ -12,88 +14,357 @@ htwk::ImagePreprocessor::ImagePreprocessor(int8_t *lutCb, int8_t *lutCr, htwk::H
       scaledWidth(scaledWidth),
       scaledHeight(scaledHeight),
       scaledImage(scaledWidth * scaledHeight * 3) {
-
+    const int blockWidth = width / scaledWidth;
+    const int blockHeight = height / scaledHeight;
+    if (blockWidth != 4 && blockWidth % 8 != 0)
+        std::cerr << __PRETTY_FUNCTION__ << ": Illegal block width!!! " << width << " scaled:" << scaledWidth << std::endl;
+    if (blockWidth * blockHeight > 256 * 4)
+        std::cerr << __PRETTY_FUNCTION__ << ": Block size too big!!!"  << std::endl;
 }
 
 void ImagePreprocessor::proceed(uint8_t *img) {
     Timer t("ImagePreprocessor", 50);
-    scaleImage(img);
+    EASY_FUNCTION();
+    proceedRows(img, 0, scaledHeight);
 }
 
-void ImagePreprocessor::scaleImage(uint8_t *img) {
-    EASY_FUNCTION();
+void ImagePreprocessor::proceedRows(const uint8_t *img, int yBegin, int yEnd) {
     const int blockWidth = width / scaledWidth;
     const int blockHeight = height / scaledHeight;
-
-    if (blockWidth == 4) {
-        scaleImage4(img);
+    float fac = 1.f / (blockWidth * blockHeight * 255);
+    float fac2 = 1.f / (blockWidth * blockHeight * 255) * 2;
+    if (tiledSinks.empty() && quantizedSinks.empty()) {
+        scaleKernel()(img + yBegin * blockHeight * width * 2, width, scaledWidth, yEnd - yBegin, blockWidth,
+                      blockHeight, fac, fac2, getOutputs(yBegin));
         return;
     }
+    // Row by row, so the row is still in the L1 cache when it is cut into the patches or quantized.
+    for (int y = yBegin; y < yEnd; y++) {
+        scaleKernel()(img + y * blockHeight * width * 2, width, scaledWidth, 1, blockWidth, blockHeight, fac, fac2,
+                      getOutputs(y));
+        writeRowSinks(y);
+    }
+}
 
-    if (blockWidth % 8 != 0)
-        std::cerr << __PRETTY_FUNCTION__ << ": Illegal block width!!! " << width << " scaled:" << scaledWidth << std::endl;
-    if (blockWidth * blockHeight > 256 * 4)
-        std::cerr << __PRETTY_FUNCTION__ << ": Block size too big!!!"  << std::endl;
+void ImagePreprocessor::writeRowSinks(int y) const {
+    for (const TiledSink& sink : tiledSinks)
+        writeTiledRows(sink, y, y + 1);
+    const size_t rowSize = scaledWidth * 3;
+    for (const QuantizedSink& sink : quantizedSinks)
+        TFLiteExecuter::quantize(scaledImage.data() + y * rowSize, sink.data + y * rowSize, rowSize,
+                                 sink.quantization);
+}
 
-    float fac = 1.f / (blockWidth * blockHeight * 255);
-    float fac2 = 1.f / (blockWidth * blockHeight * 255) * 2;
+ImagePreprocessor::Outputs ImagePreprocessor::getOutputs(int y) {
+    const size_t offset = y * scaledWidth * 3;
+    Outputs outputs;
+    outputs.push_back(scaledImage.data() + offset);
+    for (float* sink : tensorSinks)
+        outputs.push_back(sink + offset);
+    return outputs;
+}
+
+void ImagePreprocessor::addTensorSink(float *sink) {
+    if (!tensorSinks.push_back(sink)) {
+        fprintf(stderr, "%s:%d: %s: Too many tensor sinks!\n", __FILE__, __LINE__, __func__);
+        exit(1);
+    }
+}
+
+void ImagePreprocessor::removeTensorSink(float *sink) {
+    FixedVector<float*, maxTensorSinks> remaining;
+    for (float* other : tensorSinks)
+        if (other != sink)
+            remaining.push_back(other);
+    tensorSinks = remaining;
+}
+
+bool ImagePreprocessor::hasTensorSink(const float *sink) const {
+    return std::find(tensorSinks.begin(), tensorSinks.end(), sink) != tensorSinks.end();
+}
+
+void ImagePreprocessor::addTiledSink(const TiledSink &sink) {
+    if (sink.patchWidth <= 0 || sink.patchHeight <= 0 || scaledWidth % sink.patchWidth != 0 ||
+        (int)sink.patchRows.size() * sink.patchHeight != scaledHeight) {
+        fprintf(stderr, "%s:%d: %s: %dx%d patches don't tile the %dx%d image!\n", __FILE__, __LINE__, __func__,
+                sink.patchWidth, sink.patchHeight, scaledWidth, scaledHeight);
+        exit(1);
+    }
+    if (!tiledSinks.push_back(sink)) {
+        fprintf(stderr, "%s:%d: %s: Too many tiled sinks!\n", __FILE__, __LINE__, __func__);
+        exit(1);
+    }
+}
+
+void ImagePreprocessor::removeTiledSink(const float *firstPatchRow) {
+    FixedVector<TiledSink, maxTiledSinks> remaining;
+    for (const TiledSink& other : tiledSinks)
+        if (other.patchRows[0] != firstPatchRow)
+            remaining.push_back(other);
+    tiledSinks = remaining;
+}
+
+bool ImagePreprocessor::hasTiledSink(const float *firstPatchRow) const {
+    return std::any_of(tiledSinks.begin(), tiledSinks.end(),
+                       [firstPatchRow](const TiledSink& sink) { return sink.patchRows[0] == firstPatchRow; });
+}
+
+void ImagePreprocessor::writeTiled(const TiledSink &sink) const {
+    writeTiledRows(sink, 0, std::min(scaledHeight, (int)sink.patchRows.size() * sink.patchHeight));
+}
+
+void ImagePreprocessor::addQuantizedSink(uint8_t *sink, const TFLiteExecuter::Quantization &quantization) {
+    if (quantization.type == TFLiteExecuter::TensorType::FLOAT32) {
+        fprintf(stderr, "%s:%d: %s: A quantized sink needs a quantized type!\n", __FILE__, __LINE__, __func__);
+        exit(1);
+    }
+    if (!quantizedSinks.push_back({sink, quantization})) {
+        fprintf(stderr, "%s:%d: %s: Too many quantized sinks!\n", __FILE__, __LINE__, __func__);
+        exit(1);
+    }
+}
+
+void ImagePreprocessor::removeQuantizedSink(const uint8_t *sink) {
+    FixedVector<QuantizedSink, maxQuantizedSinks> remaining;
+    for (const QuantizedSink& other : quantizedSinks)
+        if (other.data != sink)
+            remaining.push_back(other);
+    quantizedSinks = remaining;
+}
+
+bool ImagePreprocessor::hasQuantizedSink(const uint8_t *sink) const {
+    return std::any_of(quantizedSinks.begin(), quantizedSinks.end(),
+                       [sink](const QuantizedSink& other) { return other.data == sink; });
+}
+
+void ImagePreprocessor::writeQuantized(uint8_t *dest, const TFLiteExecuter::Quantization &quantization) const {
+    TFLiteExecuter::quantize(scaledImage.data(), dest, scaledImage.size(), quantization);
+}
+
+void ImagePreprocessor::writeTiledRows(const TiledSink &sink, int yBegin, int yEnd) const {
+    const int channels = 3;
+    const int patchRowSize = sink.patchWidth * channels;
+    const int patchSize = sink.patchHeight * patchRowSize;
+    for (int y = yBegin; y < yEnd; y++) {
+        const float* src = scaledImage.data() + y * scaledWidth * channels;
+        float* dest = sink.patchRows[y / sink.patchHeight] + (y % sink.patchHeight) * patchRowSize;
+        for (int x = 0; x + patchRowSize <= scaledWidth * channels; x += patchRowSize, dest += patchSize)
+            memcpy(dest, src + x, patchRowSize * sizeof(float));
+    }
+}
+
+void ImagePreprocessor::fillRows(int yBegin, int yEnd, float value) {
+    const size_t rowSize = scaledWidth * 3;
+    for (float* output : getOutputs(yBegin))
+        std::fill(output, output + (yEnd - yBegin) * rowSize, value);
+    for (int y = yBegin; y < yEnd; y++)
+        writeRowSinks(y);
+}
+
+void ImagePreprocessor::proceed(const ImagePreprocessor &finer, int yBegin) {
+    EASY_FUNCTION();
+    if (finer.scaledWidth != scaledWidth * 2 || finer.scaledHeight != scaledHeight * 2) {
+        std::cerr << __PRETTY_FUNCTION__ << ": Can't halve " << finer.scaledWidth << "x" << finer.scaledHeight
+                  << " to " << scaledWidth << "x" << scaledHeight << std::endl;
+        exit(1);
+    }
+
+    const int channels = 3;
+    const int finerStride = finer.scaledWidth * channels;
+    for (int y = yBegin; y < scaledHeight; y++) {
+        const float* row1 = finer.scaledImage.data() + 2 * y * finerStride;
+        const float* row2 = row1 + finerStride;
+        float* dest = scaledImage.data() + y * scaledWidth * channels;
+        for (int x = 0; x < scaledWidth * channels; x += channels) {
+            for (int c = 0; c < channels; c++) {
+                dest[x + c] = (row1[2 * x + c] + row1[2 * x + channels + c] + row2[2 * x + c] +
+                               row2[2 * x + channels + c]) * 0.25f;
+            }
+        }
+        // The row is still in the L1 cache.
+        for (float* sink : tensorSinks)
+            memcpy(sink + y * scaledWidth * channels, dest, scaledWidth * channels * sizeof(float));
+        writeRowSinks(y);
+    }
+}
+
+namespace {
+
+// Sums of all Y, U and V of a block as [Y, U, V, -] from 16 bit sums in the order of the image (Y U Y V Y U Y V).
+inline __m128i reduceYuyv(__m128i sum16) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sum = _mm_add_epi32(_mm_unpacklo_epi16(sum16, zero), _mm_unpackhi_epi16(sum16, zero));  // Y U Y V
+    sum = _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 1, 0));                                              // Y U V Y
+    return _mm_add_epi32(sum, _mm_srli_si128(sum, 12));
+}
+
+inline void storeYuv(const ImagePreprocessor::Outputs &outputs, size_t offset, __m128i sum16, __m128 fac) {
+    float yuv[4];
+    _mm_storeu_ps(yuv, _mm_mul_ps(_mm_cvtepi32_ps(reduceYuyv(sum16)), fac));
+    for (float *dest : outputs) {
+        dest[offset + 0] = yuv[0];
+        dest[offset + 1] = yuv[1];
+        dest[offset + 2] = yuv[2];
+    }
+}
+
+// Writes 4 blocks as 12 interleaved floats Y U V Y U V ...
+inline void storeYuv4(const ImagePreprocessor::Outputs &outputs, size_t offset, __m128i sum0, __m128i sum1,
+                      __m128i sum2, __m128i sum3, __m128 fac) {
+    const __m128 p0 = _mm_mul_ps(_mm_cvtepi32_ps(reduceYuyv(sum0)), fac);
+    const __m128 p1 = _mm_mul_ps(_mm_cvtepi32_ps(reduceYuyv(sum1)), fac);
+    const __m128 p2 = _mm_mul_ps(_mm_cvtepi32_ps(reduceYuyv(sum2)), fac);
+    const __m128 p3 = _mm_mul_ps(_mm_cvtepi32_ps(reduceYuyv(sum3)), fac);
+    const __m128 v0y1 = _mm_shuffle_ps(p0, p1, _MM_SHUFFLE(0, 0, 2, 2));
+    const __m128 v2y3 = _mm_shuffle_ps(p2, p3, _MM_SHUFFLE(0, 0, 2, 2));
+    const __m128 out0 = _mm_shuffle_ps(p0, v0y1, _MM_SHUFFLE(2, 0, 1, 0));
+    const __m128 out1 = _mm_shuffle_ps(p1, p2, _MM_SHUFFLE(1, 0, 2, 1));
+    const __m128 out2 = _mm_shuffle_ps(v2y3, p3, _MM_SHUFFLE(2, 1, 2, 0));
+    for (float *dest : outputs) {
+        _mm_storeu_ps(dest + offset, out0);
+        _mm_storeu_ps(dest + offset + 4, out1);
+        _mm_storeu_ps(dest + offset + 8, out2);
+    }
+}
+
+inline __m128i sumBlockSse2(const uint8_t *start, int blockWidth, int blockHeight, int rowBytes) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sum16 = _mm_setzero_si128();
+    for (int y2 = 0; y2 < blockHeight; y2++) {
+        for (int x2 = 0; x2 < blockWidth / 8; x2++) {
+            __m128i in = _mm_loadu_si128((__m128i*)(start + x2 * 16 + y2 * rowBytes));
+            sum16 = _mm_add_epi16(sum16, _mm_unpacklo_epi8(in, zero));
+            sum16 = _mm_add_epi16(sum16, _mm_unpackhi_epi8(in, zero));
+        }
+    }
+    return sum16;
+}
+
+// Two blocks that are 4 pixels wide.
+inline void sumBlocks4Sse2(const uint8_t *start, int blockHeight, int rowBytes, __m128i &sum0, __m128i &sum1) {
+    const __m128i zero = _mm_setzero_si128();
+    sum0 = _mm_setzero_si128();
+    sum1 = _mm_setzero_si128();
+    for (int y2 = 0; y2 < blockHeight; y2++) {
+        __m128i in = _mm_loadu_si128((__m128i*)(start + y2 * rowBytes));
+        sum0 = _mm_add_epi16(sum0, _mm_unpacklo_epi8(in, zero));
+        sum1 = _mm_add_epi16(sum1, _mm_unpackhi_epi8(in, zero));
+    }
+}
+
+void scaleSse2(const uint8_t *img, int width, int scaledWidth, int scaledHeight, int blockWidth, int blockHeight,
+               float facY, float facUV, const ImagePreprocessor::Outputs &outputs) {
+    const __m128 fac = _mm_setr_ps(facY, facUV, facUV, 0.f);
+    const int rowBytes = width * 2;
+    const int blockBytes = blockWidth * 2;
     for (int y = 0; y < scaledHeight; y++) {
-        for (int x = 0; x < scaledWidth; x++) {
-            // yy uu yy vv yy uu yy vv
-            __m128i sum16 = _mm_setzero_si128();
-            const uint8_t* start = img + x * blockWidth * 2 + y * blockHeight * width * 2;
-            for (int y2 = 0; y2 < blockHeight; y2++) {
-                for (int x2 = 0; x2 < blockWidth / 8; x2++) {
-                    __m128i in = _mm_loadu_si128((__m128i*)(start + x2 * 16 + y2 * width * 2));
-                    sum16 = _mm_add_epi16(sum16, _mm_unpacklo_epi8(in, _mm_setzero_si128()));
-                    sum16 = _mm_add_epi16(sum16, _mm_unpackhi_epi8(in, _mm_setzero_si128()));
-                }
+        const uint8_t *row = img + y * blockHeight * rowBytes;
+        const size_t rowOffset = y * 3 * scaledWidth;
+        int x = 0;
+        for (; x + 4 <= scaledWidth; x += 4) {
+            __m128i sum[4];
+            if (blockWidth == 4) {
+                sumBlocks4Sse2(row + x * blockBytes, blockHeight, rowBytes, sum[0], sum[1]);
+                sumBlocks4Sse2(row + (x + 2) * blockBytes, blockHeight, rowBytes, sum[2], sum[3]);
+            } else {
+                for (int i = 0; i < 4; i++)
+                    sum[i] = sumBlockSse2(row + (x + i) * blockBytes, blockWidth, blockHeight, rowBytes);
             }
-            int valY = (int)((uint16_t*)&sum16)[0] + (int)((uint16_t*)&sum16)[2] + (int)((uint16_t*)&sum16)[4] + (int)((uint16_t*)&sum16)[6];
-            int valU = (int)((uint16_t*)&sum16)[1] + (int)((uint16_t*)&sum16)[5];
-            int valV = (int)((uint16_t*)&sum16)[3] + (int)((uint16_t*)&sum16)[7];
-            scaledImage[0 + x * 3 + y * 3 * scaledWidth] = valY * fac;
-            scaledImage[1 + x * 3 + y * 3 * scaledWidth] = valU * fac2;
-            scaledImage[2 + x * 3 + y * 3 * scaledWidth] = valV * fac2;
+            storeYuv4(outputs, rowOffset + x * 3, sum[0], sum[1], sum[2], sum[3], fac);
+        }
+        for (; x < scaledWidth; x++) {
+            __m128i sum = _mm_setzero_si128();
+            if (blockWidth == 4) {
+                __m128i unused;
+                sumBlocks4Sse2(row + x * blockBytes, blockHeight, rowBytes, sum, unused);
+            } else {
+                sum = sumBlockSse2(row + x * blockBytes, blockWidth, blockHeight, rowBytes);
+            }
+            storeYuv(outputs, rowOffset + x * 3, sum, fac);
         }
     }
 }
 
-void ImagePreprocessor::scaleImage4(uint8_t *img) {
-    EASY_FUNCTION();
-    const int blockWidth = width / scaledWidth;
-    const int blockHeight = height / scaledHeight;
-    if (blockWidth * blockHeight > 256 * 4)
-        std::cerr << __PRETTY_FUNCTION__ << ": Block size too big!!!"  << std::endl;
-    float fac = 1.f / (blockWidth * blockHeight * 255);
-    float fac2 = 1.f / (blockWidth * blockHeight * 255) * 2;
+// Like scaleSse2(), but with 32 byte loads. Adding the 16 bit sums of both halves at the end gives the same sums as
+// the SSE2 version, so the results are bit-identical.
+__attribute__((target("avx2"))) void scaleAvx2(const uint8_t *img, int width, int scaledWidth, int scaledHeight,
+                                               int blockWidth, int blockHeight, float facY, float facUV,
+                                               const ImagePreprocessor::Outputs &outputs) {
+    if ((blockWidth != 4 && blockWidth != 8 && blockWidth % 16 != 0) || scaledWidth % 4 != 0) {
+        scaleSse2(img, width, scaledWidth, scaledHeight, blockWidth, blockHeight, facY, facUV, outputs);
+        return;
+    }
+
+    const __m128 fac = _mm_setr_ps(facY, facUV, facUV, 0.f);
+    const __m256i zero = _mm256_setzero_si256();
+    const int rowBytes = width * 2;
+    const int blockBytes = blockWidth * 2;
     for (int y = 0; y < scaledHeight; y++) {
-        for (int x = 0; x < scaledWidth; x+=2) {
-            // yy uu yy vv yy uu yy vv
-            __m128i sum16 = _mm_setzero_si128();
-            __m128i sum16_2 = _mm_setzero_si128();
-            const uint8_t* start = img + x * blockWidth * 2 + y * blockHeight * width * 2;
-            for (int y2 = 0; y2 < blockHeight; y2++) {
-                __m128i in = _mm_loadu_si128((__m128i*)(start + y2 * width * 2));
-                sum16 = _mm_add_epi16(sum16, _mm_unpacklo_epi8(in, _mm_setzero_si128()));
-                sum16_2 = _mm_add_epi16(sum16_2, _mm_unpackhi_epi8(in, _mm_setzero_si128()));
+        const uint8_t *row = img + y * blockHeight * rowBytes;
+        const size_t rowOffset = y * 3 * scaledWidth;
+        for (int x = 0; x < scaledWidth; x += 4) {
+            const uint8_t *start = row + x * blockBytes;
+            __m128i sum[4];
+            if (blockWidth == 4) {
+                // One load has all 4 blocks: 0 and 1 in the low half, 2 and 3 in the high half.
+                __m256i sumLo = _mm256_setzero_si256();
+                __m256i sumHi = _mm256_setzero_si256();
+                for (int y2 = 0; y2 < blockHeight; y2++) {
+                    __m256i in = _mm256_loadu_si256((__m256i*)(start + y2 * rowBytes));
+                    sumLo = _mm256_add_epi16(sumLo, _mm256_unpacklo_epi8(in, zero));
+                    sumHi = _mm256_add_epi16(sumHi, _mm256_unpackhi_epi8(in, zero));
+                }
+                sum[0] = _mm256_castsi256_si128(sumLo);
+                sum[1] = _mm256_castsi256_si128(sumHi);
+                sum[2] = _mm256_extracti128_si256(sumLo, 1);
+                sum[3] = _mm256_extracti128_si256(sumHi, 1);
+            } else if (blockWidth == 8) {
+                // One load has two blocks, one in each half.
+                __m256i sum01 = _mm256_setzero_si256();
+                __m256i sum23 = _mm256_setzero_si256();
+                for (int y2 = 0; y2 < blockHeight; y2++) {
+                    __m256i in01 = _mm256_loadu_si256((__m256i*)(start + y2 * rowBytes));
+                    __m256i in23 = _mm256_loadu_si256((__m256i*)(start + 32 + y2 * rowBytes));
+                    sum01 = _mm256_add_epi16(sum01, _mm256_unpacklo_epi8(in01, zero));
+                    sum01 = _mm256_add_epi16(sum01, _mm256_unpackhi_epi8(in01, zero));
+                    sum23 = _mm256_add_epi16(sum23, _mm256_unpacklo_epi8(in23, zero));
+                    sum23 = _mm256_add_epi16(sum23, _mm256_unpackhi_epi8(in23, zero));
+                }
+                sum[0] = _mm256_castsi256_si128(sum01);
+                sum[1] = _mm256_extracti128_si256(sum01, 1);
+                sum[2] = _mm256_castsi256_si128(sum23);
+                sum[3] = _mm256_extracti128_si256(sum23, 1);
+            } else {
+                for (int i = 0; i < 4; i++) {
+                    const uint8_t *block = start + i * blockBytes;
+                    __m256i sum16 = _mm256_setzero_si256();
+                    for (int y2 = 0; y2 < blockHeight; y2++) {
+                        for (int x2 = 0; x2 < blockWidth / 16; x2++) {
+                            __m256i in = _mm256_loadu_si256((__m256i*)(block + x2 * 32 + y2 * rowBytes));
+                            sum16 = _mm256_add_epi16(sum16, _mm256_unpacklo_epi8(in, zero));
+                            sum16 = _mm256_add_epi16(sum16, _mm256_unpackhi_epi8(in, zero));
+                        }
+                    }
+                    sum[i] = _mm_add_epi16(_mm256_castsi256_si128(sum16), _mm256_extracti128_si256(sum16, 1));
+                }
             }
-            int valY = (int)((uint16_t*)&sum16)[0] + (int)((uint16_t*)&sum16)[2] + (int)((uint16_t*)&sum16)[4] + (int)((uint16_t*)&sum16)[6];
-            int valU = (int)((uint16_t*)&sum16)[1] + (int)((uint16_t*)&sum16)[5];
-            int valV = (int)((uint16_t*)&sum16)[3] + (int)((uint16_t*)&sum16)[7];
-            scaledImage[0 + x * 3 + y * 3 * scaledWidth] = valY * fac;
-            scaledImage[1 + x * 3 + y * 3 * scaledWidth] = valU * fac2;
-            scaledImage[2 + x * 3 + y * 3 * scaledWidth] = valV * fac2;
-            int valY2 = (int)((uint16_t*)&sum16_2)[0] + (int)((uint16_t*)&sum16_2)[2] + (int)((uint16_t*)&sum16_2)[4] + (int)((uint16_t*)&sum16_2)[6];
-            int valU2 = (int)((uint16_t*)&sum16_2)[1] + (int)((uint16_t*)&sum16_2)[5];
-            int valV2 = (int)((uint16_t*)&sum16_2)[3] + (int)((uint16_t*)&sum16_2)[7];
-            scaledImage[0 + (x+1) * 3 + y * 3 * scaledWidth] = valY2 * fac;
-            scaledImage[1 + (x+1) * 3 + y * 3 * scaledWidth] = valU2 * fac2;
-            scaledImage[2 + (x+1) * 3 + y * 3 * scaledWidth] = valV2 * fac2;
+            storeYuv4(outputs, rowOffset + x * 3, sum[0], sum[1], sum[2], sum[3], fac);
         }
     }
 }
 
+}  // namespace
+
+ImagePreprocessor::ScaleKernel ImagePreprocessor::scaleKernel() {
+    static const ScaleKernel kernel = []() -> ScaleKernel {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return scaleAvx2;
+        return scaleSse2;
+    }();
+    return kernel;
+}
+
 void ImagePreprocessor::createInputDataRaw(const uint8_t* img, std::vector<float>& dest) {
     EASY_FUNCTION();
     const int blockWidth = width / scaledWidth;
@@ -108,26 +379,9 @@ void ImagePreprocessor::createInputDataRaw(const uint8_t* img, std::vector<float
     }
     float fac = 1.f / (blockWidth * blockHeight);
     float fac2 = 1.f / (blockWidth * blockHeight) * 2;
-    for (int y = 0; y < scaledHeight; y++) {
-        for (int x = 0; x < scaledWidth; x++) {
-            // yy uu yy vv yy uu yy vv
-            __m128i sum16 = _mm_setzero_si128();
-            const uint8_t* start = img + x * blockWidth * 2 + y * blockHeight * width * 2;
-            for (int y2 = 0; y2 < blockHeight; y2++) {
-                for (int x2 = 0; x2 < blockWidth / 8; x2++) {
-                    __m128i in = _mm_loadu_si128((__m128i*)(start + x2 * 16 + y2 * width * 2));
-                    sum16 = _mm_add_epi16(sum16, _mm_unpacklo_epi8(in, _mm_setzero_si128()));
-                    sum16 = _mm_add_epi16(sum16, _mm_unpackhi_epi8(in, _mm_setzero_si128()));
-                }
-            }
-            int valY = (int)((uint16_t*)&sum16)[0] + (int)((uint16_t*)&sum16)[2] + (int)((uint16_t*)&sum16)[4] + (int)((uint16_t*)&sum16)[6];
-            int valU = (int)((uint16_t*)&sum16)[1] + (int)((uint16_t*)&sum16)[5];
-            int valV = (int)((uint16_t*)&sum16)[3] + (int)((uint16_t*)&sum16)[7];
-            dest[0 + x * 3 + y * 3 * scaledWidth] = valY * fac;
-            dest[1 + x * 3 + y * 3 * scaledWidth] = valU * fac2;
-            dest[2 + x * 3 + y * 3 * scaledWidth] = valV * fac2;
-        }
-    }
+    Outputs outputs;
+    outputs.push_back(dest.data());
+    scaleKernel()(img, width, scaledWidth, scaledHeight, blockWidth, blockHeight, fac, fac2, outputs);
 }
 
 void ImagePreprocessor::drawScaledImage(uint8_t *yuvImage) {
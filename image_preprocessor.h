@@ -4,6 +4,8 @@
 #include <vector>
 
 #include <base_detector.h>
+#include <fixed_vector.h>
+#include <tfliteexecuter.h>
 
 namespace htwk {
 
@@ -20,8 +22,52 @@ public:
     ~ImagePreprocessor() = default;
 
     void proceed(uint8_t* img);
+    // Only the scaled rows [yBegin, yEnd).
+    void proceedRows(const uint8_t* img, int yBegin, int yEnd);
+    // Averages 2x2 pixels of an image with twice our size, see ImagePyramid. Only the rows from yBegin on.
+    void proceed(const ImagePreprocessor& finer, int yBegin = 0);
+    // Fills the rows [yBegin, yEnd) with a constant instead of scaling them, e.g. rows that can't show the field.
+    void fillRows(int yBegin, int yEnd, float value = 0.f);
 
-    const std::vector<float>& getScaledImage() { return scaledImage; }
+    const std::vector<float>& getScaledImage() const { return scaledImage; }
+    int getScaledWidth() const { return scaledWidth; }
+    int getScaledHeight() const { return scaledHeight; }
+    // Number of image rows that make up one scaled row.
+    int getBlockHeight() const { return height / scaledHeight; }
+
+    // The scaled image is also written straight into these buffers (e.g. the input tensor of a consumer), so it
+    // doesn't have to copy it. A consumer that finds its buffer here can skip the copy.
+    static constexpr int maxTensorSinks = 3;
+    void addTensorSink(float* sink);
+    void removeTensorSink(float* sink);
+    bool hasTensorSink(const float* sink) const;
+    // The scaled image and the tensor sinks, every output gets the same values.
+    using Outputs = FixedVector<float*, maxTensorSinks + 1>;
+
+    // Patch-major layout of a batched input tensor (patch row x patch column x patchHeight x patchWidth x 3). The
+    // patches of one patch row follow each other, patchRows[py] points to the first one.
+    static constexpr int maxPatchRows = 4;
+    struct TiledSink {
+        int patchWidth;
+        int patchHeight;
+        FixedVector<float*, maxPatchRows> patchRows;
+    };
+    // Like a tensor sink, but the scaled image is cut into patches on the way. A tiled sink is identified by its first
+    // patch row.
+    static constexpr int maxTiledSinks = 2;
+    void addTiledSink(const TiledSink& sink);
+    void removeTiledSink(const float* firstPatchRow);
+    bool hasTiledSink(const float* firstPatchRow) const;
+    // Copies the scaled image into the patches, for consumers that aren't a tiled sink.
+    void writeTiled(const TiledSink& sink) const;
+
+    // The input tensor of a quantized model, it gets the quantized scaled image.
+    static constexpr int maxQuantizedSinks = 2;
+    void addQuantizedSink(uint8_t* sink, const TFLiteExecuter::Quantization& quantization);
+    void removeQuantizedSink(const uint8_t* sink);
+    bool hasQuantizedSink(const uint8_t* sink) const;
+    // Quantizes the scaled image, for consumers that aren't a quantized sink.
+    void writeQuantized(uint8_t* dest, const TFLiteExecuter::Quantization& quantization) const;
 
     void drawScaledImage(uint8_t *yuvImage);
 
@@ -32,9 +78,24 @@ private:
     const int scaledHeight;
 
     std::vector<float> scaledImage;
+    FixedVector<float*, maxTensorSinks> tensorSinks;
+    FixedVector<TiledSink, maxTiledSinks> tiledSinks;
+    struct QuantizedSink {
+        uint8_t* data;
+        TFLiteExecuter::Quantization quantization;
+    };
+    FixedVector<QuantizedSink, maxQuantizedSinks> quantizedSinks;
+
+    Outputs getOutputs(int y);
+    void writeTiledRows(const TiledSink& sink, int yBegin, int yEnd) const;
+    // Writes a finished row to the tiled and quantized sinks.
+    void writeRowSinks(int y) const;
+
+    // Scales with the fastest kernel the CPU supports, all of them give bit-identical results.
+    using ScaleKernel = void (*)(const uint8_t* img, int width, int scaledWidth, int scaledHeight, int blockWidth,
+                                 int blockHeight, float facY, float facUV, const Outputs& outputs);
+    static ScaleKernel scaleKernel();
 
-    void scaleImage(uint8_t *img);
-    void scaleImage4(uint8_t *img);
 };
 
 }
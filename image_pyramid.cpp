@@ -0,0 +1,161 @@
+#include "image_pyramid.h"
+
+#include <algorithm>
+#include <tuple>
+
+#include <easy/profiler.h>
+
+namespace htwk {
+
+ImagePyramid::ImagePyramid(int8_t* lutCb, int8_t* lutCr, HtwkVisionConfig& config,
+                           std::vector<std::pair<int, int>> scaledSizes, ThreadPool* thread_pool, int numBands) {
+    std::sort(scaledSizes.begin(), scaledSizes.end(), std::greater<>());
+    scaledSizes.erase(std::unique(scaledSizes.begin(), scaledSizes.end()), scaledSizes.end());
+
+    for (const auto& [scaledWidth, scaledHeight] : scaledSizes) {
+        Level level{std::make_shared<ImagePreprocessor>(lutCb, lutCr, config, scaledWidth, scaledHeight), nullptr};
+        for (const Level& other : levels) {
+            if (other.image->getScaledWidth() == 2 * scaledWidth &&
+                other.image->getScaledHeight() == 2 * scaledHeight) {
+                level.finer = other.image.get();
+                break;
+            }
+        }
+        levels.push_back(std::move(level));
+    }
+
+    if (!levels.empty())
+        numBands = std::min(numBands, levels[0].image->getScaledHeight());
+    if (thread_pool == nullptr || numBands <= 1)
+        return;
+
+    this->numBands = numBands;
+    using Priority = TaskGraph::Priority;
+    bandGraph = std::make_unique<TaskGraph>(thread_pool);
+    std::vector<TaskGraph::Task> bands;
+    for (int band = 0; band < numBands; band++)
+        bands.push_back(bandGraph->addTask([this, band]() { proceedBand(band); }, {}, Priority::REQUIRED,
+                                           "ImagePyramidBand"));
+    auto carry = bandGraph->addTask([this]() { carryIntegralBands(); }, bands, Priority::REQUIRED,
+                                    "IntegralImageCarry");
+    for (int band = 1; band < numBands; band++)
+        bandGraph->addTask([this, band]() { fixIntegralBand(band); }, {carry}, Priority::REQUIRED,
+                           "IntegralImageFixBand");
+    bandGraph->addTask([this]() { proceedSmallerLevels(); }, bands, Priority::REQUIRED, "ImagePyramidLevels");
+}
+
+void ImagePyramid::proceed(uint8_t* img, const IntegralImage* integralImage, int maskedRows) {
+    Timer t("ImagePyramid", 50);
+    EASY_FUNCTION();
+    currentImg = img;
+    currentIntegralImage = integralImage;
+    // Masked at whole rows of the smallest level, so a level never averages masked rows of a finer one into a row that
+    // isn't masked.
+    int blockHeight = 1;
+    for (const Level& level : levels)
+        blockHeight = std::max(blockHeight, level.image->getBlockHeight());
+    currentMaskedRows = maskedRows - maskedRows % blockHeight;
+    if (bandGraph) {
+        bandGraph->run();
+    } else {
+        proceedBand(0);
+        proceedSmallerLevels();
+    }
+}
+
+// The integral rows can be made together with the rows of the largest level if they need whole image rows of it.
+bool ImagePyramid::isIntegralImageFused() const {
+    return !levels.empty() && levels[0].image->getBlockHeight() % IntegralImage::INTEGRAL_SCALE == 0;
+}
+
+std::pair<int, int> ImagePyramid::getIntegralBand(int band) const {
+    const int integralHeight = currentIntegralImage->iHeight;
+    if (!isIntegralImageFused())
+        return {integralHeight * band / numBands, integralHeight * (band + 1) / numBands};
+
+    const ImagePreprocessor& largest = *levels[0].image;
+    const int integralRowsPerRow = largest.getBlockHeight() / IntegralImage::INTEGRAL_SCALE;
+    const int begin = largest.getScaledHeight() * band / numBands * integralRowsPerRow;
+    const int end = band == numBands - 1 ? integralHeight
+                                         : largest.getScaledHeight() * (band + 1) / numBands * integralRowsPerRow;
+    return {std::min(begin, integralHeight), std::min(end, integralHeight)};
+}
+
+void ImagePyramid::proceedBand(int band) {
+    EASY_FUNCTION();
+    int integralRow = 0;
+    int integralEnd = 0;
+    if (currentIntegralImage)
+        std::tie(integralRow, integralEnd) = getIntegralBand(band);
+    const int integralBegin = integralRow;
+
+    if (!levels.empty()) {
+        ImagePreprocessor& largest = *levels[0].image;
+        const int yBegin = largest.getScaledHeight() * band / numBands;
+        const int yEnd = largest.getScaledHeight() * (band + 1) / numBands;
+        const int integralRowsPerRow = largest.getBlockHeight() / IntegralImage::INTEGRAL_SCALE;
+        const bool fused = currentIntegralImage && isIntegralImageFused();
+        const int masked = getMaskedRows(largest);
+        for (int y = yBegin; y < yEnd; y++) {
+            if (y < masked)
+                largest.fillRows(y, y + 1);
+            else
+                largest.proceedRows(currentImg, y, y + 1);
+            if (fused) {
+                const int rowsEnd = std::min(integralRow + integralRowsPerRow, integralEnd);
+                currentIntegralImage->proceedRows(currentImg, integralRow, rowsEnd, integralRow == integralBegin);
+                integralRow = rowsEnd;
+            }
+        }
+    }
+    if (currentIntegralImage && integralRow < integralEnd)
+        currentIntegralImage->proceedRows(currentImg, integralRow, integralEnd, integralRow == integralBegin);
+}
+
+// Makes the last row of every band final, top to bottom.
+void ImagePyramid::carryIntegralBands() {
+    if (!currentIntegralImage)
+        return;
+    int lastRow = -1;
+    for (int band = 0; band < numBands; band++) {
+        const auto [begin, end] = getIntegralBand(band);
+        if (begin == end)
+            continue;
+        if (lastRow >= 0)
+            currentIntegralImage->addRow(lastRow, end - 1, end);
+        lastRow = end - 1;
+    }
+}
+
+void ImagePyramid::fixIntegralBand(int band) {
+    if (!currentIntegralImage)
+        return;
+    const auto [begin, end] = getIntegralBand(band);
+    if (begin > 0 && begin < end)
+        currentIntegralImage->addRow(begin - 1, begin, end - 1);
+}
+
+void ImagePyramid::proceedSmallerLevels() {
+    for (size_t i = 1; i < levels.size(); i++) {
+        Level& level = levels[i];
+        const int masked = getMaskedRows(*level.image);
+        level.image->fillRows(0, masked);
+        if (level.finer)
+            level.image->proceed(*level.finer, masked);
+        else
+            level.image->proceedRows(currentImg, masked, level.image->getScaledHeight());
+    }
+}
+
+int ImagePyramid::getMaskedRows(const ImagePreprocessor& level) const {
+    return std::min(currentMaskedRows / level.getBlockHeight(), level.getScaledHeight());
+}
+
+std::shared_ptr<ImagePreprocessor> ImagePyramid::getLevel(int scaledWidth, int scaledHeight) const {
+    for (const Level& level : levels)
+        if (level.image->getScaledWidth() == scaledWidth && level.image->getScaledHeight() == scaledHeight)
+            return level.image;
+    return nullptr;
+}
+
+}  // namespace htwk
@@ -0,0 +1,70 @@
+#ifndef IMAGE_PYRAMID_H
+#define IMAGE_PYRAMID_H
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <async.h>
+#include <image_preprocessor.h>
+#include <integral_image.h>
+
+namespace htwk {
+
+/**
+ * Scaled images in several sizes that are made from one pass over the camera image. Only the largest level reads the
+ * image, every level that is half as wide and high as another one averages 2x2 pixels of it. Sizes that aren't a
+ * halving of another level read the image themselves.
+ *
+ * The integral image can be made in the same pass: it is built band by band right after the largest level, while
+ * those image rows are still in the cache.
+ *
+ * With a ThreadPool, horizontal bands of the image are done in parallel. Each band integrates its rows as if it was
+ * the whole image, then the last rows of the bands are added up from top to bottom and every band adds the last row
+ * of the band above.
+ */
+class ImagePyramid {
+public:
+    ImagePyramid(int8_t* lutCb, int8_t* lutCr, HtwkVisionConfig& config,
+                 std::vector<std::pair<int, int>> scaledSizes, ThreadPool* thread_pool = nullptr, int numBands = 1);
+    ImagePyramid(const ImagePyramid&) = delete;
+    ImagePyramid(const ImagePyramid&&) = delete;
+    ImagePyramid& operator=(const ImagePyramid&) = delete;
+    ImagePyramid& operator=(ImagePyramid&&) = delete;
+    ~ImagePyramid() = default;
+
+    // integralImage may be nullptr. The scaled rows that lie completely above the image row maskedRows are filled
+    // with 0 instead of scaled.
+    void proceed(uint8_t* img, const IntegralImage* integralImage = nullptr, int maskedRows = 0);
+
+    // nullptr if the pyramid has no level of this size.
+    std::shared_ptr<ImagePreprocessor> getLevel(int scaledWidth, int scaledHeight) const;
+
+private:
+    struct Level {
+        std::shared_ptr<ImagePreprocessor> image;
+        // The level this one is averaged from, nullptr if it is scaled from the camera image.
+        const ImagePreprocessor* finer;
+    };
+
+    // Largest first, so every level comes after the one it is made from.
+    std::vector<Level> levels;
+
+    int numBands = 1;
+    std::unique_ptr<TaskGraph> bandGraph;
+    uint8_t* currentImg = nullptr;
+    const IntegralImage* currentIntegralImage = nullptr;
+    int currentMaskedRows = 0;
+
+    bool isIntegralImageFused() const;
+    std::pair<int, int> getIntegralBand(int band) const;
+    void proceedBand(int band);
+    void carryIntegralBands();
+    void fixIntegralBand(int band);
+    void proceedSmallerLevels();
+    int getMaskedRows(const ImagePreprocessor& level) const;
+};
+
+}  // namespace htwk
+
+#endif  // IMAGE_PYRAMID_H
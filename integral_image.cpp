@@ -1,5 +1,6 @@
 #include "integral_image.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <iostream>
 #include <emmintrin.h>
@@ -11,10 +12,13 @@ namespace htwk {
 IntegralImage::IntegralImage(int8_t *lutCb, int8_t *lutCr, HtwkVisionConfig &config)
 : BaseDetector(lutCb, lutCr, config), iWidth(config.width / INTEGRAL_SCALE), iHeight(config.height / INTEGRAL_SCALE) {
     integralImg = static_cast<int*>(aligned_alloc(16, iWidth*iHeight*sizeof(int)));
+    zeroRow = static_cast<int*>(aligned_alloc(16, iWidth*sizeof(int)));
+    std::fill(zeroRow, zeroRow + iWidth, 0);
 }
 
 IntegralImage::~IntegralImage() {
     free(integralImg);
+    free(zeroRow);
 }
 
 
@@ -24,12 +28,24 @@ IntegralImage::~IntegralImage() {
 void IntegralImage::proceed(uint8_t *img) const {
     Timer t("IntegralImage", 50);
     EASY_FUNCTION(profiler::colors::Red100);
+    proceedRows(img, 0, iHeight);
+}
 
-    integralImg[0]=getValue(img,0,0);
-    for(int x=1;x<iWidth;x++){
-        integralImg[x]=integralImg[x-1]+(getValue(img,x*INTEGRAL_SCALE,0));
-    }
+void IntegralImage::setFirstRow(int imageRow) {
+    firstRow = std::clamp(imageRow / INTEGRAL_SCALE, 0, iHeight);
+}
+
+void IntegralImage::proceedRows(const uint8_t *img, int yBegin, int yEnd, bool bandStart) const {
+    // The row above the first one of the image or of a band is 0.
+    auto above = [this, yBegin, bandStart](int y) {
+        return y == 0 || (bandStart && y == yBegin) ? zeroRow : &integralImg[(y - 1) * iWidth];
+    };
 
+    const __m128i zero = _mm_setzero_si128();
+    for (int y = yBegin; y < std::min(yEnd, firstRow); y++)
+        for (int x = 0; x < iWidth; x += 4)
+            _mm_stream_si128((__m128i*)&integralImg[x + y * iWidth], zero);
+    yBegin = std::max(yBegin, firstRow);
 
     if (INTEGRAL_SCALE == 2) {
         const int factor = 4;
@@ -39,12 +55,13 @@ void IntegralImage::proceed(uint8_t *img) const {
         //__m128i y_mask = _mm_set_epi32(0xff, 0xff, 0xff, 0xff);
         //__m128i v_mask = _mm_set_epi32(0xff000000, 0xff000000, 0xff000000, 0xff000000);
         __m128i fff0 = _mm_setr_epi32(-1, -1, -1, 0);
-        for(int y=1;y<iHeight;y++){
+        for(int y=yBegin;y<yEnd;y++){
             __m128i sum=_mm_set1_epi32(0);
+            const int* aboveRow = above(y);
             for(int x=0;x<iWidth/factor;x++){
                 const int addr0=x*factor+y*iWidth;
 
-                const __m128i i0 = _mm_load_si128((__m128i*)&(integralImg[addr0-iWidth]));
+                const __m128i i0 = _mm_load_si128((const __m128i*)&aboveRow[x*factor]);
                 // yuyv yuyv yuyv yuyv
                 // x  x x  x x  x x  x
                 // mask v
@@ -54,7 +71,7 @@ void IntegralImage::proceed(uint8_t *img) const {
                 // x    x    x    x
                 // v2 (epi32+) y
                 int xr = x * factor * INTEGRAL_SCALE;
-                __m128i ycr = _mm_load_si128((__m128i*)&img[(xr + y*INTEGRAL_SCALE*width)<<1]);
+                __m128i ycr = _mm_load_si128((const __m128i*)&img[(xr + y*INTEGRAL_SCALE*width)<<1]);
                 __m128i y = _mm_and_si128(ycr, y_mask);
                 __m128i v = _mm_and_si128(ycr, v_mask);
                 __m128i vs7 = _mm_srli_epi32(v, 23);
@@ -75,18 +92,19 @@ void IntegralImage::proceed(uint8_t *img) const {
         }
     } else {
         const int factor = 16;
-        for(int y=1;y<iHeight;y++){
+        for(int y=yBegin;y<yEnd;y++){
             int sum=0;
+            const int* aboveRow = above(y);
             for(int x=0;x<iWidth/factor;x++){
                 const int addr0=x*factor+y*iWidth+0;
                 const int addr1=x*factor+y*iWidth+4;
                 const int addr2=x*factor+y*iWidth+8;
                 const int addr3=x*factor+y*iWidth+12;
 
-                const __m128i i0 = _mm_load_si128((__m128i*)&(integralImg[addr0-iWidth]));
-                const __m128i i1 = _mm_load_si128((__m128i*)&(integralImg[addr1-iWidth]));
-                const __m128i i2 = _mm_load_si128((__m128i*)&(integralImg[addr2-iWidth]));
-                const __m128i i3 = _mm_load_si128((__m128i*)&(integralImg[addr3-iWidth]));
+                const __m128i i0 = _mm_load_si128((const __m128i*)&aboveRow[x*factor+0]);
+                const __m128i i1 = _mm_load_si128((const __m128i*)&aboveRow[x*factor+4]);
+                const __m128i i2 = _mm_load_si128((const __m128i*)&aboveRow[x*factor+8]);
+                const __m128i i3 = _mm_load_si128((const __m128i*)&aboveRow[x*factor+12]);
 
                 const int cr0  = sum  + getValue(img,(x*factor+ 0)*INTEGRAL_SCALE,y*INTEGRAL_SCALE);
                 const int cr1  = cr0  + getValue(img,(x*factor+ 1)*INTEGRAL_SCALE,y*INTEGRAL_SCALE);
@@ -123,6 +141,17 @@ void IntegralImage::proceed(uint8_t *img) const {
             }
         }
     }
+    // The rows are read by other threads.
+    _mm_sfence();
+}
+
+void IntegralImage::addRow(int row, int yBegin, int yEnd) const {
+    const __m128i* src = (const __m128i*)&integralImg[row * iWidth];
+    for (int y = yBegin; y < yEnd; y++) {
+        __m128i* dest = (__m128i*)&integralImg[y * iWidth];
+        for (int x = 0; x < iWidth / 4; x++)
+            _mm_store_si128(dest + x, _mm_add_epi32(_mm_load_si128(dest + x), _mm_load_si128(src + x)));
+    }
 }
 
 }//namespace htwk
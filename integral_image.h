@@ -9,6 +9,8 @@ namespace htwk {
 class IntegralImage : protected BaseDetector {
 private:
     int* integralImg;
+    int* zeroRow;
+    int firstRow = 0;
 
 public:
     static constexpr int INTEGRAL_SCALE = 2;//only 1,2 or 4
@@ -27,6 +29,14 @@ public:
     }
 
     void proceed(uint8_t *img) const __attribute__((nonnull));
+    // Only the integral rows [yBegin, yEnd), all rows above have to be done already. With bandStart the rows are
+    // integrated as if yBegin was the first row of the image, so horizontal bands can be done in parallel. Adding the
+    // last row of the band above with addRow() makes them whole.
+    void proceedRows(const uint8_t *img, int yBegin, int yEnd, bool bandStart = false) const __attribute__((nonnull));
+    // Adds the integral row to the rows [yBegin, yEnd).
+    void addRow(int row, int yBegin, int yEnd) const;
+    // The rows above this image row are 0 instead of integrated, so sums that reach above it only count the rows below.
+    void setFirstRow(int imageRow);
     inline const int* getIntegralImg() { return integralImg; }
 };
 }//namespace htwk
@@ -5,8 +5,9 @@
 namespace htwk {
 using namespace std;
 
-void JerseyDetection::proceed(uint8_t* img) {
-    this->img = img;
+void JerseyDetection::proceed(const PlanarImage& img, const GreenMask* greenMask) {
+    this->img = &img;
+    this->greenMask = greenMask;
     vector<RobotBoundingBox>& robots = uc_robot_detector->getMutableBoundingBoxes();
     params = prepareDetectionBoxes(robots);
     body_color = getBodyColor(params);
@@ -46,8 +47,15 @@ color JerseyDetection::getBodyColor(const vector<JerseyDetectionParams>& params)
                 point_2d d = point_2d(x, y) - p.p;
                 if (d.norm() <= p.diameter / 2)
                     continue;
-                color c = getColor(img, x, y);
-                if (!field_color_detector->maybeGreen(c)) {
+                // A half resolution mask only classified the even pixels, so take the colour from the pixel the
+                // mask bit belongs to.
+                int cx = x, cy = y;
+                if (greenMask) {
+                    cx -= x % greenMask->scale;
+                    cy -= y % greenMask->scale;
+                }
+                color c = getColor(*img, cx, cy);
+                if (!(greenMask ? greenMask->isMaybeGreen(cx, cy) : field_color_detector->maybeGreen(c))) {
                     avg_white += c;
                     cnt_white++;
                 }
@@ -76,7 +84,7 @@ void JerseyDetection::estimateColorProbabilities(const vector<JerseyDetectionPar
                 point_2d d = point_2d(x, y) - params.p;
                 if (d.norm() > params.diameter / 2)
                     continue;
-                color c = getColor(img, x, y);
+                color c = getColor(*img, x, y);
                 float dist_green = c.dist(green, 4);
                 float dist_own = c.dist(own, 4);
                 float dist_other = c.dist(other, 4);
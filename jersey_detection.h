@@ -3,6 +3,8 @@
 #include <base_detector.h>
 #include <color.h>
 #include <field_color_detector.h>
+#include <green_mask.h>
+#include <planar_image.h>
 #include <uc_robot_detector.h>
 
 #include <vector>
@@ -28,7 +30,8 @@ public:
     JerseyDetection& operator=(const JerseyDetection&) = delete;
     JerseyDetection& operator=(JerseyDetection&&) = delete;
 
-    void proceed(uint8_t* img) __attribute__((nonnull));
+    // Takes the field color of the pixels from greenMask if there is one.
+    void proceed(const PlanarImage& img, const GreenMask* greenMask = nullptr);
     void drawDebugOutput(uint8_t* img);
     void teamColorCallback(uint8_t own_team_id, uint8_t own_team_color, uint8_t opp_team_id, uint8_t opp_team_color);
 
@@ -49,7 +52,8 @@ private:
     UpperCamRobotDetector* uc_robot_detector;
     color own_color_rel{-50, 20, -10};
     color opp_color_rel{-40, -20, 5};
-    uint8_t* img;
+    const PlanarImage* img = nullptr;
+    const GreenMask* greenMask = nullptr;
     std::vector<JerseyDetectionParams> params;
     color body_color;
 };
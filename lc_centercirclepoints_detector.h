@@ -31,7 +31,7 @@ public:
         return cur_hyp;
     }
 
-    std::vector<ObjectHypothesis> getHypotheses() const {
+    const std::vector<ObjectHypothesis>& getHypotheses() const {
         return hypotheses;
     }
 
@@ -46,8 +46,9 @@ void LowerCameraScrambledCameraDetector::proceed(std::shared_ptr<ImagePreprocess
 
     wasExecutedFlag = true;
     EASY_BLOCK("LowerCameraScrambledCameraDetector Prepare");
-    std::memcpy(input, imagePreprocessor->getScaledImage().data(),
-                imagePreprocessor->getScaledImage().size() * sizeof(float));
+    if (!imagePreprocessor->hasTensorSink(input))
+        std::memcpy(input, imagePreprocessor->getScaledImage().data(),
+                    imagePreprocessor->getScaledImage().size() * sizeof(float));
     EASY_END_BLOCK;
 
     EASY_BLOCK("LowerCameraScrambledCameraDetector Execute");
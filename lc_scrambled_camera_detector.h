@@ -35,6 +35,11 @@ public:
 
     void shouldRun(bool state);
 
+    // The ImagePreprocessor can write straight into this, see ImagePreprocessor::addTensorSink().
+    float* getInputTensor() const {
+        return input;
+    }
+
 private:
     static constexpr int channels = 3;
     bool isCameraScrambledFlag = false;
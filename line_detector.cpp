@@ -32,12 +32,8 @@ void LineDetector::proceed(uint8_t *img, vector<LineSegment *> lineSegments, int
     Timer t("LineDetector", 50);
     EASY_FUNCTION(profiler::colors::Lime100);
     vector<LineSegment *> lineSegmentsSrc = lineSegments;
-    if (!linesTmp.empty()) {
-        for (LineEdge *ls : linesTmp) {
-            delete (ls);
-        }
-        linesTmp.clear();
-    }
+    linesTmp.clear();
+    lineEdgeArena.reset();
 
     // sort and link lineEdges for faster neighbor-search
     sort(lineSegments.begin(), lineSegments.end(), compareLineSegments);
@@ -47,11 +43,13 @@ void LineDetector::proceed(uint8_t *img, vector<LineSegment *> lineSegments, int
     LineSegment *pred = nullptr;
     for (LineSegment *ls : lineSegments) {
         ls->minError = numeric_limits<float>::infinity();
+        ls->neighborsBegin = ls->neighborsEnd = 0;
         if (pred != nullptr) {
             ls->pred = pred;
         }
         pred = ls;
     }
+    sortedSegments = lineSegments;
 
     // search for near line-edges with similar angle and save the best match for every line-edge
     int rMax = (int)(q * 2.8f);
@@ -83,13 +81,16 @@ void LineDetector::proceed(uint8_t *img, vector<LineSegment *> lineSegments, int
     }
 
     // search for near line-edges with similar angle and group/link them together into individual neighborhood lists for
-    // every line-edge
+    // every line-edge. The pairs are collected first and then stored as one index array with a range per line-edge,
+    // every list is in the order the pairs were found.
     rMax = (int)(q * 8);
     rMin = (int)(q * 0.9f);
-    for (LineSegment *ls : lineSegments) {
-        LineSegment *neighbor = ls->pred;
+    neighborPairs.clear();
+    for (int i = 0; i < (int)sortedSegments.size(); i++) {
+        LineSegment *ls = sortedSegments[i];
         int minX = ls->x - rMax;
-        while (neighbor != nullptr && neighbor->x >= minX) {
+        for (int j = i - 1; j >= 0 && sortedSegments[j]->x >= minX; j--) {
+            LineSegment *neighbor = sortedSegments[j];
             int diffY = neighbor->y - ls->y;
             if (diffY > -rMax && diffY < rMax) {
                 int diffX = neighbor->x - ls->x;
@@ -97,14 +98,25 @@ void LineDetector::proceed(uint8_t *img, vector<LineSegment *> lineSegments, int
                 if (dist < rMax * rMax && dist > rMin * rMin) {
                     float d = getError2(ls, neighbor);
                     if (d <= 0.75f) {
-                        ls->neighbors.push_back(neighbor);
-                        neighbor->neighbors.push_back(ls);
+                        neighborPairs.emplace_back(i, j);
+                        ls->neighborsEnd++;
+                        neighbor->neighborsEnd++;
                     }
                 }
             }
-            neighbor = neighbor->pred;
         }
     }
+    int neighborCnt = 0;
+    for (LineSegment *ls : sortedSegments) {
+        ls->neighborsBegin = neighborCnt;
+        neighborCnt += ls->neighborsEnd;
+        ls->neighborsEnd = ls->neighborsBegin;
+    }
+    neighbors.resize(neighborCnt);
+    for (const auto &[a, b] : neighborPairs) {
+        neighbors[sortedSegments[a]->neighborsEnd++] = b;
+        neighbors[sortedSegments[b]->neighborsEnd++] = a;
+    }
     //---------------------------------------
 
     // search points, which only have neighbors in one direction (possible end-points from long lines in the image)
@@ -112,10 +124,11 @@ void LineDetector::proceed(uint8_t *img, vector<LineSegment *> lineSegments, int
     vector<LineSegment *> endPoints;
     for (LineSegment *ls : lineSegments) {
         ls->id = 0;
-        if (ls->neighbors.size() < 3)
+        if (ls->neighborsEnd - ls->neighborsBegin < 3)
             continue;
         memset(angles, 0, sizeof(int) * 36);
-        for (LineSegment *n : ls->neighbors) {
+        for (int k = ls->neighborsBegin; k < ls->neighborsEnd; k++) {
+            const LineSegment *n = sortedSegments[neighbors[k]];
             float dx = ls->x - n->x;
             float dy = ls->y - n->y;
             float angle = atan2(dy, dx);
@@ -151,7 +164,8 @@ void LineDetector::proceed(uint8_t *img, vector<LineSegment *> lineSegments, int
         int sumX = 0;
         int sumY = 0;
 //        int cnt = 0;
-        for (LineSegment *n : ls->neighbors) {
+        for (int k = ls->neighborsBegin; k < ls->neighborsEnd; k++) {
+            const LineSegment *n = sortedSegments[neighbors[k]];
             int dx = n->x - ls->x;
             int dy = n->y - ls->y;
             if (dx < 0 || (dx == 0 && dy < 0)) {
@@ -176,7 +190,8 @@ void LineDetector::proceed(uint8_t *img, vector<LineSegment *> lineSegments, int
             float nx = -vy;
             float ny = vx;
             float d = ls->x * nx + ls->y * ny;
-            for (LineSegment *n : next->neighbors) {
+            for (int k = next->neighborsBegin; k < next->neighborsEnd; k++) {
+                LineSegment *n = sortedSegments[neighbors[k]];
                 float dist = n->x * nx + n->y * ny - d;
                 if (abs(dist) < 4 && n->id == 0) {
                     n->id = id;
@@ -200,7 +215,7 @@ void LineDetector::proceed(uint8_t *img, vector<LineSegment *> lineSegments, int
     int numLinesTmp = id - 1;
     linesTmp.resize(numLinesTmp);
     for (int i = 0; i < id - 1; i++) {
-        linesTmp[i] = new LineEdge(i + 1);
+        linesTmp[i] = lineEdgeArena.create(i + 1);
     }
 
     for (LineSegment *ls : lineSegments) {
@@ -518,15 +533,6 @@ LineDetector::LineDetector(const int8_t *lutCb, const int8_t *lutCr, HtwkVisionC
     }
 }
 
-LineDetector::~LineDetector() {
-    if (!linesTmp.empty()) {
-        for (LineEdge *ls : linesTmp) {
-            delete (ls);
-        }
-        linesTmp.clear();
-    }
-}
-
 // test, if a given line is really straight, or maybe curvy
 bool LineDetector::isStraight(LineEdge *line) {
     vector<LineSegment *> leftSegments;
@@ -4,10 +4,12 @@
 #include <cstdint>
 #include <cstdlib>
 #include <optional>
+#include <utility>
 #include <vector>
 
 #include "base_detector.h"
 #include "color.h"
+#include "frame_arena.h"
 #include "linecross.h"
 #include "lineedge.h"
 #include "linegroup.h"
@@ -26,7 +28,7 @@ public:
     color white{200, 128, 128};
 
     LineDetector(const int8_t *lutCb, const int8_t *lutCr, HtwkVisionConfig &config);
-    ~LineDetector();
+    ~LineDetector() = default;
 
     bool isStraight(LineEdge *line) __attribute__((nonnull));
     static float getError(LineSegment *le1, LineSegment *le2) __attribute__((nonnull));
@@ -45,6 +47,14 @@ private:
     float maxError = 0.7;
     float isStraightThreshold = 0.999;
     int detectedLineCrossings = 0;
+
+    // The LineEdges in linesTmp, they live until the next proceed().
+    FrameArena<LineEdge, 64> lineEdgeArena;
+    // The segments of proceed() sorted by x, LineSegment::neighborsBegin/End index into neighbors and neighbors into
+    // sortedSegments.
+    std::vector<LineSegment *> sortedSegments;
+    std::vector<int> neighbors;
+    std::vector<std::pair<int, int>> neighborPairs;
 };
 
 }  // namespace htwk
@@ -2,7 +2,6 @@
 #define LINESEGMENT_H_
 
 #include <limits>
-#include <vector>
 
 #include "lineedge.h"
 
@@ -21,7 +20,9 @@ public:
 
   // Datenstrukturen, um zusammengehÃ¶rige Liniensegmente zu gruppieren
 
-  std::vector<LineSegment *> neighbors;
+  // Range in LineDetector::neighbors, it holds indices into the segments sorted by x.
+  int neighborsBegin {0};
+  int neighborsEnd {0};
   LineSegment *bestNeighbor {nullptr};
   LineSegment *pred {nullptr};
   LineSegment *link {nullptr};
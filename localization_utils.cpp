@@ -2,6 +2,9 @@
 #include <localization_utils.h>
 #include <point_3d.h>
 
+#include <algorithm>
+#include <cmath>
+
 using namespace std;
 using namespace htwk;
 
@@ -149,6 +152,13 @@ bool LocalizationUtils::belowHorizon(const point_2d& p, const Line& horizon) {
     return (p.x - horizon.px1) * (horizon.py1 - horizon.py2) + (p.y - horizon.py1) * (horizon.px2 - horizon.px1) > 0;
 }
 
+int LocalizationUtils::getFieldTopRow(const CamPose& cam_pose, int margin) {
+    optional<Line> horizon = getHorizon(cam_pose);
+    if (!horizon)
+        return 0;
+    return std::clamp((int)std::floor(std::min(horizon->py1, horizon->py2)) - margin, 0, cam_height);
+}
+
 optional<float> LocalizationUtils::getObjectDist(const point_2d& p_, float height_above_ground,
                                                  const CamPose& cam_pose) {
     if (cam_pose.v5_angles)
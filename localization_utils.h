@@ -29,6 +29,9 @@ public:
     // TODO: Test all the functions below on a robot.
     static std::optional<htwk::Line> getHorizon(const CamPose& cam_pose);
     static bool belowHorizon(const htwk::point_2d& p, const htwk::Line& horizon);
+    // The first image row that can show the field: the highest point of the horizon minus margin. 0 if there is no
+    // horizon, cam_height if the whole image is above it.
+    static int getFieldTopRow(const CamPose& cam_pose, int margin);
     static std::optional<float> getObjectDist(const htwk::point_2d& p, float height_above_ground,
                                               const CamPose& cam_pose);
     static std::optional<float> getPixelRadius(const htwk::point_2d& p, const CamPose& cam_pose, float obj_radius);
@@ -13,12 +13,10 @@ using namespace std;
 namespace htwk {
 
 ObjectDetectorLowCamHypGen::ObjectDetectorLowCamHypGen(int8_t* lutCb, int8_t* lutCr, HtwkVisionConfig &config,
-                                                       std::string modelFile,
-                                                       std::shared_ptr<ImagePreprocessor> imagePreprocessor)
+                                                       std::string modelFile)
     : BaseDetector(lutCb, lutCr, config),
       inputWidth(config.lcObjectDetectorConfig.scaledImageWidth),
-      inputHeight(config.lcObjectDetectorConfig.scaledImageHeight),
-      imagePreprocessor(imagePreprocessor) {
+      inputHeight(config.lcObjectDetectorConfig.scaledImageHeight) {
 
     if(config.lcObjectDetectorConfig.classifyHypData) {
         hypGenExecuter.loadModelFromFile(config.tflitePath + "/" + modelFile, {1, inputHeight, inputWidth, channels});
@@ -42,11 +40,12 @@ ObjectDetectorLowCamHypGen::~ObjectDetectorLowCamHypGen() {
 
 }
 
-void ObjectDetectorLowCamHypGen::proceed(CamPose& cam_pose) {
+void ObjectDetectorLowCamHypGen::proceed(CamPose& cam_pose, std::shared_ptr<ImagePreprocessor> imagePreprocessor) {
     Timer t("ObjectDetectorLowCamHypGen", 50);
     EASY_FUNCTION();
-    std::memcpy(inputHypFinder, imagePreprocessor->getScaledImage().data(),
-                imagePreprocessor->getScaledImage().size() * sizeof(float));
+    if (!imagePreprocessor->hasTensorSink(inputHypFinder))
+        std::memcpy(inputHypFinder, imagePreprocessor->getScaledImage().data(),
+                    imagePreprocessor->getScaledImage().size() * sizeof(float));
 
     if(!config.lcObjectDetectorConfig.classifyHypData)
         return;
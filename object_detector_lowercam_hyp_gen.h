@@ -18,23 +18,26 @@ public:
     const int inputWidth;
     const int inputHeight;
 
-    ObjectDetectorLowCamHypGen(int8_t* lutCb, int8_t* lutCr, HtwkVisionConfig& config, std::string modelFile,
-                               std::shared_ptr<ImagePreprocessor> imagePreprocessor);
+    ObjectDetectorLowCamHypGen(int8_t* lutCb, int8_t* lutCr, HtwkVisionConfig& config, std::string modelFile);
     ObjectDetectorLowCamHypGen(const ObjectDetectorLowCamHypGen&) = delete;
     ObjectDetectorLowCamHypGen(const ObjectDetectorLowCamHypGen&&) = delete;
     ObjectDetectorLowCamHypGen& operator=(const ObjectDetectorLowCamHypGen&) = delete;
     ObjectDetectorLowCamHypGen& operator=(ObjectDetectorLowCamHypGen&&) = delete;
     ~ObjectDetectorLowCamHypGen();
 
-    void proceed(CamPose& cam_pose);
+    void proceed(CamPose& cam_pose, std::shared_ptr<ImagePreprocessor> imagePreprocessor);
 
     ObjectHypothesis getObjectHypotheses() const {
         return outputObject;
     }
 
+    // The ImagePreprocessor can write straight into this, see ImagePreprocessor::addTensorSink().
+    float* getInputTensor() const {
+        return inputHypFinder;
+    }
+
 private:
     static constexpr int channels = 3;
-    std::shared_ptr<ImagePreprocessor> imagePreprocessor;
 
     ObjectHypothesis outputObject;
     float* inputHypFinder;
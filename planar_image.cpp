@@ -0,0 +1,58 @@
+#include "planar_image.h"
+
+#include <cstdlib>
+#include <emmintrin.h>
+
+#include <easy/profiler.h>
+
+namespace htwk {
+
+PlanarImage::PlanarImage(const HtwkVisionConfig& config) : width(config.width), height(config.height) {
+    yPlane = static_cast<uint8_t*>(aligned_alloc(16, width * height));
+    cbPlane = static_cast<uint8_t*>(aligned_alloc(16, width / 2 * height));
+    crPlane = static_cast<uint8_t*>(aligned_alloc(16, width / 2 * height));
+}
+
+PlanarImage::~PlanarImage() {
+    free(yPlane);
+    free(cbPlane);
+    free(crPlane);
+}
+
+void PlanarImage::proceed(const uint8_t* img) {
+    EASY_FUNCTION();
+    proceedRows(img, 0, height);
+}
+
+void PlanarImage::proceedRows(const uint8_t* img, int yBegin, int yEnd) {
+    // Two pixels (Y Cb Y Cr) per 4 bytes, the rows of the planes follow each other like the ones of the image.
+    const int begin = yBegin * width;
+    const int end = yEnd * width;
+    const __m128i lowBytes = _mm_set1_epi16(0xff);
+    int i = begin;
+    for (; i + 32 <= end; i += 32) {
+        const __m128i* src = (const __m128i*)(img + 2 * i);
+        const __m128i p0 = _mm_loadu_si128(src);
+        const __m128i p1 = _mm_loadu_si128(src + 1);
+        const __m128i p2 = _mm_loadu_si128(src + 2);
+        const __m128i p3 = _mm_loadu_si128(src + 3);
+        const __m128i y0 = _mm_packus_epi16(_mm_and_si128(p0, lowBytes), _mm_and_si128(p1, lowBytes));
+        const __m128i y1 = _mm_packus_epi16(_mm_and_si128(p2, lowBytes), _mm_and_si128(p3, lowBytes));
+        // Cb Cr Cb Cr ...
+        const __m128i c0 = _mm_packus_epi16(_mm_srli_epi16(p0, 8), _mm_srli_epi16(p1, 8));
+        const __m128i c1 = _mm_packus_epi16(_mm_srli_epi16(p2, 8), _mm_srli_epi16(p3, 8));
+        _mm_storeu_si128((__m128i*)(yPlane + i), y0);
+        _mm_storeu_si128((__m128i*)(yPlane + i + 16), y1);
+        _mm_storeu_si128((__m128i*)(cbPlane + i / 2),
+                         _mm_packus_epi16(_mm_and_si128(c0, lowBytes), _mm_and_si128(c1, lowBytes)));
+        _mm_storeu_si128((__m128i*)(crPlane + i / 2), _mm_packus_epi16(_mm_srli_epi16(c0, 8), _mm_srli_epi16(c1, 8)));
+    }
+    for (; i < end; i += 2) {
+        yPlane[i] = img[2 * i];
+        yPlane[i + 1] = img[2 * i + 2];
+        cbPlane[i / 2] = img[2 * i + 1];
+        crPlane[i / 2] = img[2 * i + 3];
+    }
+}
+
+}  // namespace htwk
@@ -0,0 +1,61 @@
+#ifndef PLANAR_IMAGE_H
+#define PLANAR_IMAGE_H
+
+#include <cstdint>
+
+#include <htwk_vision_config.h>
+
+namespace htwk {
+
+/**
+ * The camera image split into a Y plane and Cb and Cr planes of half the width, made once per frame. A pixel is a plain
+ * index into a plane instead of an address in the interleaved YUYV image and every row is contiguous, so loops over
+ * the planes can be vectorized. BaseDetector has getY(), getCb(), getCr() and getColor() for both kinds of images.
+ */
+class PlanarImage {
+public:
+    explicit PlanarImage(const HtwkVisionConfig& config);
+    PlanarImage(const PlanarImage&) = delete;
+    PlanarImage(PlanarImage&&) = delete;
+    PlanarImage& operator=(const PlanarImage&) = delete;
+    PlanarImage& operator=(PlanarImage&&) = delete;
+    ~PlanarImage();
+
+    void proceed(const uint8_t* img) __attribute__((nonnull));
+    // Only the image rows [yBegin, yEnd).
+    void proceedRows(const uint8_t* img, int yBegin, int yEnd) __attribute__((nonnull));
+
+    inline uint8_t getY(int32_t x, int32_t y) const {
+        return yPlane[x + y * width];
+    }
+    inline uint8_t getCb(int32_t x, int32_t y) const {
+        return cbPlane[(x + y * width) >> 1];
+    }
+    inline uint8_t getCr(int32_t x, int32_t y) const {
+        return crPlane[(x + y * width) >> 1];
+    }
+
+    // width values
+    inline const uint8_t* getYRow(int32_t y) const {
+        return yPlane + y * width;
+    }
+    // width / 2 values
+    inline const uint8_t* getCbRow(int32_t y) const {
+        return cbPlane + y * (width / 2);
+    }
+    inline const uint8_t* getCrRow(int32_t y) const {
+        return crPlane + y * (width / 2);
+    }
+
+    const int width;
+    const int height;
+
+private:
+    uint8_t* yPlane;
+    uint8_t* cbPlane;
+    uint8_t* crPlane;
+};
+
+}  // namespace htwk
+
+#endif  // PLANAR_IMAGE_H
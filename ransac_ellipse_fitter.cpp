@@ -40,13 +40,14 @@ void RansacEllipseFitter::proceed(const vector<LineSegment*> &lineEdgeSegments,
     EASY_FUNCTION(profiler::colors::Orange100);
 
     ellipseFound=false;
+    midSegments.reset();
     vector<LineSegment*> curveSegments;
     vector<LineSegment*> curveSegmentsFiltered;
     for(const LineSegment *ls : lineEdgeSegments){
         if(ls->parentLine!=nullptr&&!ls->parentLine->straight){
             //da nur eine Ellipse in der Mitte der Linie berechnet werden soll,
             //werden hier jeweils zwei zusammengehörige Linienkanten gemittelt
-            LineSegment *lsMid=new LineSegment(	(ls->x+ls->link->x)/2,
+            LineSegment *lsMid=midSegments.create(	(ls->x+ls->link->x)/2,
                     (ls->y+ls->link->y)/2,
                     (ls->vx-ls->link->vx)/2,
                     (ls->vy-ls->link->vy)/2);
@@ -93,10 +94,6 @@ void RansacEllipseFitter::proceed(const vector<LineSegment*> &lineEdgeSegments,
     }else{
         resultEllipse.found=false;
     }
-
-    for(LineSegment *ls : curveSegments){
-        delete ls;
-    }
 }
 
 float RansacEllipseFitter::getRating(const vector<LineSegment*> &carryover, const Ellipse& e){
@@ -6,6 +6,7 @@
 
 #include "base_detector.h"
 #include "ellipse.h"
+#include "frame_arena.h"
 #include "htwk_vision_config.h"
 #include "linesegment.h"
 #include "point_2d.h"
@@ -28,6 +29,8 @@ private:
     std::mt19937 rng;
     std::uniform_real_distribution<float> dist{0,1};
     int abortState{0};
+    // Centers of the curved segment pairs of the last proceed().
+    FrameArena<LineSegment> midSegments;
 
 public:
     RansacEllipseFitter(const int8_t* lutCb, const int8_t* lutCr, HtwkVisionConfig& config);
@@ -1,5 +1,6 @@
 #include "region_classifier.h"
 
+#include <algorithm>
 #include <easy/profiler.h>
 
 #include <robotoption.h>
@@ -23,9 +24,9 @@ int RegionClassifier::maxLineBorder = 6;  // maximal distance (px) between
 // line-border and the green
 // neighbor-regions
 
-RegionClassifier::RegionClassifier(int8_t *lutCb, int8_t *lutCr, HtwkVisionConfig &config)
+RegionClassifier::RegionClassifier(int8_t *lutCb, int8_t *lutCr, HtwkVisionConfig &config, ThreadPool *thread_pool,
+                                   int numBands)
     : BaseDetector(lutCb, lutCr, config),
-      pattern{0},
       upperCam(config.isUpperCam),
       lineSpacing(config.isUpperCam ? 12 : 10) {
     lineRegionsCnt = 0;
@@ -62,6 +63,19 @@ RegionClassifier::RegionClassifier(int8_t *lutCb, int8_t *lutCr, HtwkVisionConfi
         options->addOption(new NaoControl::IntOption("maxLineBorder", &maxLineBorder, 0, 100, 1));
         NaoControl::RobotOption::instance().addOptionSet(options);
     }
+
+    numBands = std::clamp(numBands, 1, height / lineSpacing);
+    this->numBands = numBands;
+    verticalSegments.resize(numBands);
+    horizontalSegments.resize(numBands);
+    segmentArenas.resize(numBands);
+    if (thread_pool == nullptr || numBands <= 1)
+        return;
+
+    bandGraph = std::make_unique<TaskGraph>(thread_pool);
+    for (int band = 0; band < numBands; band++)
+        bandGraph->addTask([this, band]() { proceedBand(band); }, {}, TaskGraph::Priority::REQUIRED,
+                           "RegionClassifierBand");
 }
 
 RegionClassifier::~RegionClassifier() {
@@ -69,88 +83,119 @@ RegionClassifier::~RegionClassifier() {
     delete[] scanHorizontal;
 }
 
-void RegionClassifier::proceed(uint8_t *img, FieldColorDetector *field) {
+void RegionClassifier::proceed(const PlanarImage& img, FieldColorDetector *field, int firstRow) {
     Timer t("RegionClassifier", 50);
     EASY_FUNCTION(profiler::colors::Cyan100);
+    this->firstRow = std::clamp(firstRow, 0, height - 2);
+    currentImg = &img;
+    currentField = field;
 
-    // reset scanlines
-    for (int i = 0; i < width / lineSpacing; i++) {
-        scanVertical[i].edgeCnt = 0;
-    }
-    for (int i = 0; i < height / lineSpacing; i++) {
-        scanHorizontal[i].edgeCnt = 0;
+    lineSegments.clear();
+
+    if (bandGraph) {
+        bandGraph->run();
+    } else {
+        proceedBand(0);
     }
 
+    for (const std::vector<LineSegment *> &segments : verticalSegments)
+        lineSegments.insert(lineSegments.end(), segments.begin(), segments.end());
+    for (const std::vector<LineSegment *> &segments : horizontalSegments)
+        lineSegments.insert(lineSegments.end(), segments.begin(), segments.end());
+}
+
+void RegionClassifier::proceedBand(int band) {
+    EASY_FUNCTION(profiler::colors::Cyan100);
+    const PlanarImage &img = *currentImg;
+    const int verticalCnt = width / lineSpacing;
+    const int horizontalCnt = height / lineSpacing;
+    const int verticalBegin = verticalCnt * band / numBands;
+    const int verticalEnd = verticalCnt * (band + 1) / numBands;
+    const int horizontalBegin = horizontalCnt * band / numBands;
+    const int horizontalEnd = horizontalCnt * (band + 1) / numBands;
+
     EASY_BLOCK("Scan Vertical");
-    int offset = lineSpacing / 2;
-    for (int x = offset; x < width; x += lineSpacing) {
-        Scanline *sl = &scanVertical[x / lineSpacing];
+    for (int i = verticalBegin; i < verticalEnd; i++)
+        scanVerticalLine(i, img, currentField);
+    EASY_END_BLOCK;
 
-        // add first edge (bottom-image-border)
-        addEdge(img, sl, x, height - 2, -1, false);
+    EASY_BLOCK("Scan Horizontal");
+    for (int i = horizontalBegin; i < horizontalEnd; i++)
+        scanHorizontalLine(i, img, currentField);
+    EASY_END_BLOCK;
 
-        // find edges on vertical scanlines
-        if (upperCam)
-            scan(img, x, height - 2, field, sl);
-        else
-            scan_avg_y(img, x, height - 2, field, sl);
+    EASY_BLOCK("Add segments");
+    segmentArenas[band].reset();
+    verticalSegments[band].clear();
+    horizontalSegments[band].clear();
+    addSegments(scanVertical, verticalBegin, verticalEnd, img, segmentArenas[band], verticalSegments[band]);
+    addSegments(scanHorizontal, horizontalBegin, horizontalEnd, img, segmentArenas[band], horizontalSegments[band]);
+    EASY_END_BLOCK;
+}
 
-        // add last edge (field-border)
-        addEdge(img, sl, x, 0, 1, false);
+void RegionClassifier::scanVerticalLine(int i, const PlanarImage& img, FieldColorDetector *field) {
+    const int x = lineSpacing / 2 + i * lineSpacing;
+    Scanline *sl = &scanVertical[i];
+    sl->edgeCnt = 0;
+    if (x >= width)
+        return;
 
-        // get region color-values
-        getColorsFromRegions(img, sl, (int)sgn(sl->vx), (int)sgn(sl->vy));
+    // add first edge (bottom-image-border)
+    addEdge(img, sl, x, height - 2, -1, false);
 
-        // classify
-        classifyGreenRegions(sl, field);
-        classifyWhiteRegions(sl);
-    }
-    EASY_END_BLOCK;
+    // find edges on vertical scanlines
+    if (upperCam)
+        scan(img, x, height - 2, field, sl);
+    else
+        scan_avg_y(img, x, height - 2, field, sl);
 
-    EASY_BLOCK("Scan Horizontal");
-    for (int y = offset; y < height; y += lineSpacing) {
-        Scanline *sl = &scanHorizontal[y / lineSpacing];
-
-        // find edges on horizontal scanlines
-        if ((y / lineSpacing) % 2 == 0) {
-            sl->vx = -2;
-            addEdge(img, sl, width - 1, y, -1, false);
-            if (upperCam)
-                scan(img, width - 1, y, field, sl);
-            else
-                scan_avg_x(img, width - 1, y, field, sl);
-            addEdge(img, sl, 0, y, 1, false);
-        } else {
-            addEdge(img, sl, 0, y, -1, false);
-            if (upperCam)
-                scan(img, 0, y, field, sl);
-            else
-                scan_avg_x(img, 0, y, field, sl);
-            addEdge(img, sl, width - 1, y, 1, false);
-        }
+    // add last edge (field-border)
+    addEdge(img, sl, x, this->firstRow, 1, false);
 
-        // get region color-values
-        getColorsFromRegions(img, sl, (int)sgn(sl->vx), (int)sgn(sl->vy));
+    // get region color-values
+    getColorsFromRegions(img, sl, (int)sgn(sl->vx), (int)sgn(sl->vy));
 
-        // classify
-        classifyGreenRegions(sl, field);
-        classifyWhiteRegions(sl);
-    }
+    // classify
+    classifyGreenRegions(sl, field);
+    classifyWhiteRegions(sl);
+}
 
-    EASY_END_BLOCK;
+void RegionClassifier::scanHorizontalLine(int i, const PlanarImage& img, FieldColorDetector *field) {
+    const int y = lineSpacing / 2 + i * lineSpacing;
+    Scanline *sl = &scanHorizontal[i];
+    sl->edgeCnt = 0;
+    if (y >= height || y < this->firstRow)
+        return;
+
+    // find edges on horizontal scanlines
+    if (i % 2 == 0) {
+        sl->vx = -2;
+        addEdge(img, sl, width - 1, y, -1, false);
+        if (upperCam)
+            scan(img, width - 1, y, field, sl);
+        else
+            scan_avg_x(img, width - 1, y, field, sl);
+        addEdge(img, sl, 0, y, 1, false);
+    } else {
+        addEdge(img, sl, 0, y, -1, false);
+        if (upperCam)
+            scan(img, 0, y, field, sl);
+        else
+            scan_avg_x(img, 0, y, field, sl);
+        addEdge(img, sl, width - 1, y, 1, false);
+    }
 
-    for (auto *ptr : lineSegments)
-        delete ptr;
-    lineSegments.clear();
+    // get region color-values
+    getColorsFromRegions(img, sl, (int)sgn(sl->vx), (int)sgn(sl->vy));
 
-    EASY_BLOCK("Add segments");
-    addSegments(scanVertical, width / lineSpacing, img);
-    addSegments(scanHorizontal, height / lineSpacing, img);
-    EASY_END_BLOCK;
+    // classify
+    classifyGreenRegions(sl, field);
+    classifyWhiteRegions(sl);
 }
 
-void RegionClassifier::addSegments(Scanline *scanlines, int scanlineCnt, uint8_t *img) {
-    for (int j = 0; j < scanlineCnt; j++) {
+void RegionClassifier::addSegments(const Scanline *scanlines, int begin, int end, const PlanarImage& img,
+                                   FrameArena<LineSegment> &arena, std::vector<LineSegment *> &segments) const {
+    for (int j = begin; j < end; j++) {
         const Scanline &sl = scanlines[j];
         for (int i = 1; i < sl.edgeCnt - 1; i++) {
             bool isWhite = sl.regionsIsWhite[i];
@@ -164,10 +209,10 @@ void RegionClassifier::addSegments(Scanline *scanlines, int scanlineCnt, uint8_t
             int lineWidth = max(abs(sl.edgesX[i] - sl.edgesX[k]), abs(sl.edgesY[i] - sl.edgesY[k]));
             point_2d vecLeft = getGradientVector(sl.edgesX[i], sl.edgesY[i], lineWidth, img);
             point_2d vecRight = getGradientVector(sl.edgesX[k], sl.edgesY[k], lineWidth, img);
-            LineSegment *lesLeft = new LineSegment(sl.edgesX[i], sl.edgesY[i], vecLeft.x, vecLeft.y);
-            lineSegments.emplace_back(lesLeft);
-            LineSegment *lesRight = new LineSegment(sl.edgesX[k], sl.edgesY[k], vecRight.x, vecRight.y);
-            lineSegments.emplace_back(lesRight);
+            LineSegment *lesLeft = arena.create(sl.edgesX[i], sl.edgesY[i], vecLeft.x, vecLeft.y);
+            segments.emplace_back(lesLeft);
+            LineSegment *lesRight = arena.create(sl.edgesX[k], sl.edgesY[k], vecRight.x, vecRight.y);
+            segments.emplace_back(lesRight);
             lesLeft->link = lesRight;
             lesRight->link = lesLeft;
             i = k;
@@ -175,7 +220,8 @@ void RegionClassifier::addSegments(Scanline *scanlines, int scanlineCnt, uint8_t
     }
 }
 
-point_2d RegionClassifier::getGradientVector(int x, int y, int lineWidth, uint8_t *img) {
+point_2d RegionClassifier::getGradientVector(int x, int y, int lineWidth, const PlanarImage& img) const {
+    int pattern[matchRadius * 2 + 1];
     float gx = 0;
     float gy = 0;
 
@@ -478,7 +524,7 @@ void RegionClassifier::classifyGreenRegions(Scanline *sl, FieldColorDetector *fi
 
 // estimate region-colors (median of 5 yCbCr-pixel-values)
 
-void RegionClassifier::getColorsFromRegions(uint8_t *img, Scanline *sl, int dirX, int dirY) const {
+void RegionClassifier::getColorsFromRegions(const PlanarImage& img, Scanline *sl, int dirX, int dirY) const {
     int dataCy[5];
     int dataCb[5];
     int dataCr[5];
@@ -529,7 +575,8 @@ void RegionClassifier::getColorsFromRegions(uint8_t *img, Scanline *sl, int dirX
 
 // search edges along scanline
 
-void RegionClassifier::scan(uint8_t *img, int xPos, int yPos, FieldColorDetector *field, Scanline *scanline) const {
+void RegionClassifier::scan(const PlanarImage& img, int xPos, int yPos, FieldColorDetector *field,
+                            Scanline *scanline) const {
     int vecX = scanline->vx;
     int vecY = scanline->vy;
     int lastCy = getY(img, xPos, yPos);
@@ -542,7 +589,7 @@ void RegionClassifier::scan(uint8_t *img, int xPos, int yPos, FieldColorDetector
     xPos += vecX;
     yPos += vecY;
     bool wasGreen = field->isGreen(lastCy, lastCb, lastCr);
-    while (xPos >= 0 && xPos < width && yPos >= 0 && yPos < height - 1) {
+    while (xPos >= 0 && xPos < width && yPos >= firstRow && yPos < height - 1) {
         int cy = getY(img, xPos, yPos);
         int cb = getCb(img, xPos, yPos);
         int cr = getCr(img, xPos, yPos);
@@ -582,7 +629,7 @@ void RegionClassifier::scan(uint8_t *img, int xPos, int yPos, FieldColorDetector
     }
 }
 
-void RegionClassifier::scan_avg_y(uint8_t *img, int xPos, int yPos, FieldColorDetector *field,
+void RegionClassifier::scan_avg_y(const PlanarImage& img, int xPos, int yPos, FieldColorDetector *field,
                                   Scanline *scanline) const {
     int vecX = scanline->vx;
     int vecY = scanline->vy;
@@ -596,7 +643,7 @@ void RegionClassifier::scan_avg_y(uint8_t *img, int xPos, int yPos, FieldColorDe
     xPos += vecX;
     yPos += vecY;
     bool wasGreen = field->isGreen(lastCy, lastCb, lastCr);
-    while (xPos >= 0 && xPos < width && yPos >= 2 && yPos < height - 2) {
+    while (xPos >= 0 && xPos < width && yPos >= std::max(2, firstRow) && yPos < height - 2) {
         int cy = ((int)getY(img, xPos, yPos - 2) + (int)getY(img, xPos, yPos - 1) + (int)getY(img, xPos, yPos) +
                   (int)getY(img, xPos, yPos + 1) + (int)getY(img, xPos, yPos + 2)) /
                  5;
@@ -642,7 +689,7 @@ void RegionClassifier::scan_avg_y(uint8_t *img, int xPos, int yPos, FieldColorDe
     }
 }
 
-void RegionClassifier::scan_avg_x(uint8_t *img, int xPos, int yPos, FieldColorDetector *field,
+void RegionClassifier::scan_avg_x(const PlanarImage& img, int xPos, int yPos, FieldColorDetector *field,
                                   Scanline *scanline) const {
     int vecX = scanline->vx;
     int vecY = scanline->vy;
@@ -706,7 +753,7 @@ void RegionClassifier::scan_avg_x(uint8_t *img, int xPos, int yPos, FieldColorDe
 // returns false, when current edges-count per scanline is higher than
 // "maxEdgesPerScanline"
 
-bool RegionClassifier::addEdge(uint8_t *img, Scanline *scanline, int xPeak, int yPeak, int edgeIntensity,
+bool RegionClassifier::addEdge(const PlanarImage& img, Scanline *scanline, int xPeak, int yPeak, int edgeIntensity,
                                bool optimize) const {
     int xBest = xPeak;
     int yBest = yPeak;
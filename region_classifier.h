@@ -4,9 +4,12 @@
 #include <memory>
 #include <vector>
 
+#include "async.h"
 #include "base_detector.h"
 #include "field_color_detector.h"
+#include "frame_arena.h"
 #include "linesegment.h"
+#include "planar_image.h"
 #include "point_2d.h"
 
 namespace htwk {
@@ -31,19 +34,26 @@ class RegionClassifier : protected BaseDetector {
 private:
     static void classifyGreenRegions(Scanline *sl, FieldColorDetector *field) __attribute__((nonnull));
     static void classifyWhiteRegions(Scanline *sl) __attribute__((nonnull));
-    bool addEdge(uint8_t *img, Scanline *scanline, int xPeak, int yPeak, int edgeIntensity, bool optimize) const
-            __attribute__((nonnull));
+    bool addEdge(const PlanarImage& img, Scanline *scanline, int xPeak, int yPeak, int edgeIntensity,
+                 bool optimize) const __attribute__((nonnull));
 
     // TODO: We need a nicer architecture for this so we can unify the 3 scan methods.
-    void scan(uint8_t *img, int xPos, int yPos, FieldColorDetector *field, Scanline *scanline) const
+    void scan(const PlanarImage& img, int xPos, int yPos, FieldColorDetector *field, Scanline *scanline) const
+            __attribute__((nonnull));
+    void scan_avg_x(const PlanarImage& img, int xPos, int yPos, FieldColorDetector *field, Scanline *scanline) const
             __attribute__((nonnull));
-    void scan_avg_x(uint8_t *img, int xPos, int yPos, FieldColorDetector *field, Scanline *scanline) const
+    void scan_avg_y(const PlanarImage& img, int xPos, int yPos, FieldColorDetector *field, Scanline *scanline) const
             __attribute__((nonnull));
-    void scan_avg_y(uint8_t *img, int xPos, int yPos, FieldColorDetector *field, Scanline *scanline) const
+    point_2d getGradientVector(int x, int y, int lineWidth, const PlanarImage& img) const;
+    void getColorsFromRegions(const PlanarImage& img, Scanline *sl, int dirX, int dirY) const __attribute__((nonnull));
+    void addSegments(const Scanline *scanlines, int begin, int end, const PlanarImage& img,
+                     FrameArena<LineSegment> &arena, std::vector<LineSegment *> &segments) const
             __attribute__((nonnull));
-    point_2d getGradientVector(int x, int y, int lineWidth, uint8_t *img) __attribute__((nonnull));
-    void getColorsFromRegions(uint8_t *img, Scanline *sl, int dirX, int dirY) const __attribute__((nonnull));
-    void addSegments(Scanline *scanlines, int scanlineCnt, uint8_t *img) __attribute__((nonnull));
+
+    // Scanlines [count * band / numBands, count * (band + 1) / numBands) of both directions.
+    void proceedBand(int band);
+    void scanVerticalLine(int i, const PlanarImage& img, FieldColorDetector *field) __attribute__((nonnull));
+    void scanHorizontalLine(int i, const PlanarImage& img, FieldColorDetector *field) __attribute__((nonnull));
 
     Scanline *scanVertical;
     Scanline *scanHorizontal;
@@ -54,8 +64,20 @@ private:
     static int greenRegionColorDist;
     int lineRegionsCnt;
     static const int matchRadius = 2;
-    int pattern[matchRadius * 2 + 1];
     bool upperCam;
+    // Rows above it aren't scanned.
+    int firstRow = 0;
+
+    // The scanlines are independent, every band is a pool task with its own segments. They are concatenated in band
+    // order, so lineSegments is the same as with one band. Each band also has its own arena for the segments, they
+    // live until the next proceed().
+    int numBands = 1;
+    std::unique_ptr<TaskGraph> bandGraph;
+    std::vector<FrameArena<LineSegment>> segmentArenas;
+    std::vector<std::vector<LineSegment *>> verticalSegments;
+    std::vector<std::vector<LineSegment *>> horizontalSegments;
+    const PlanarImage *currentImg = nullptr;
+    FieldColorDetector *currentField = nullptr;
 
 public:
     const int lineSpacing;
@@ -65,14 +87,17 @@ public:
     std::vector<LineSegment*> lineSegments;
 
     RegionClassifier(const RegionClassifier &cpy) = delete;
-    RegionClassifier(int8_t *lutCb, int8_t *lutCr, HtwkVisionConfig &config) __attribute__((nonnull));
+    RegionClassifier(int8_t *lutCb, int8_t *lutCr, HtwkVisionConfig &config, ThreadPool *thread_pool = nullptr,
+                     int numBands = 1);
     ~RegionClassifier();
     RegionClassifier(RegionClassifier &) = delete;
     RegionClassifier(RegionClassifier &&) = delete;
     RegionClassifier &operator=(const RegionClassifier &cpy) = delete;
     RegionClassifier &operator=(RegionClassifier &&cpy) = delete;
 
-    void proceed(uint8_t *img, FieldColorDetector *field) __attribute__((nonnull));
+    // Rows above firstRow can't show the field (see LocalizationUtils::getFieldTopRow), the vertical scanlines end there
+    // and the horizontal ones above it stay empty.
+    void proceed(const PlanarImage& img, FieldColorDetector *field, int firstRow = 0) __attribute__((nonnull));
     int getScanVerticalSize() {
         return width / lineSpacing;
     }
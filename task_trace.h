@@ -0,0 +1,121 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+// Collects when tasks became ready, started and ended and on which pool worker they ran. writeChromeTrace() writes
+// everything as Chrome trace_event JSON (chrome://tracing, ui.perfetto.dev): one track per worker, one flow arrow per
+// frame that connects its tasks in start order. Recording doesn't allocate and doesn't lock, events beyond the capacity
+// are dropped.
+class TaskTrace {
+public:
+    struct Event {
+        const char* name;
+        const char* group;
+        uint64_t frame;
+        int64_t readyUs;
+        int64_t startUs;
+        int64_t endUs;
+        // Index of the pool worker, -1 for threads that don't belong to the pool.
+        int worker;
+    };
+
+    explicit TaskTrace(size_t capacity = 1 << 16) : events(capacity), epoch(std::chrono::steady_clock::now()) {}
+    TaskTrace(const TaskTrace&) = delete;
+    TaskTrace(TaskTrace&&) = delete;
+    TaskTrace& operator=(const TaskTrace&) = delete;
+    TaskTrace& operator=(TaskTrace&&) = delete;
+
+    int64_t toUs(std::chrono::steady_clock::time_point t) const {
+        return std::chrono::duration_cast<std::chrono::microseconds>(t - epoch).count();
+    }
+    int64_t nowUs() const {
+        return toUs(std::chrono::steady_clock::now());
+    }
+
+    uint64_t beginFrame() {
+        return nextFrame.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void record(const Event& event) {
+        const size_t i = recorded.fetch_add(1, std::memory_order_relaxed);
+        if (i < events.size())
+            events[i] = event;
+    }
+
+    size_t droppedEvents() const {
+        const size_t n = recorded.load(std::memory_order_relaxed);
+        return n > events.size() ? n - events.size() : 0;
+    }
+
+    // Only call these while nothing is recording.
+    void clear() {
+        recorded.store(0, std::memory_order_relaxed);
+    }
+
+    bool writeChromeTrace(const std::string& filename) const {
+        FILE* f = fopen(filename.c_str(), "w");
+        if (f == nullptr) {
+            fprintf(stderr, "%s:%d: %s: Couldn't open %s!\n", __FILE__, __LINE__, __func__, filename.c_str());
+            return false;
+        }
+
+        const size_t count = std::min(recorded.load(std::memory_order_acquire), events.size());
+        std::set<int> workers;
+        std::map<uint64_t, std::vector<const Event*>> frames;
+        for (size_t i = 0; i < count; i++) {
+            workers.insert(events[i].worker);
+            frames[events[i].frame].push_back(&events[i]);
+        }
+
+        fprintf(f, "{\"traceEvents\":[\n");
+        const char* separator = "";
+        for (int worker : workers) {
+            fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s%d\"}}",
+                    separator, tid(worker), worker < 0 ? "external" : "worker ", std::max(worker, 0));
+            separator = ",\n";
+        }
+        for (size_t i = 0; i < count; i++) {
+            const Event& e = events[i];
+            fprintf(f,
+                    "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%lld,\"dur\":%lld,"
+                    "\"args\":{\"frame\":%llu,\"queuedUs\":%lld}}",
+                    separator, e.name, e.group, tid(e.worker), (long long)e.startUs, (long long)(e.endUs - e.startUs),
+                    (unsigned long long)e.frame, (long long)(e.startUs - e.readyUs));
+            separator = ",\n";
+        }
+        for (auto& [frame, frameEvents] : frames) {
+            std::sort(frameEvents.begin(), frameEvents.end(),
+                      [](const Event* a, const Event* b) { return a->startUs < b->startUs; });
+            for (size_t i = 0; i < frameEvents.size() && frameEvents.size() > 1; i++) {
+                const char* phase = i == 0 ? "s" : (i + 1 == frameEvents.size() ? "f" : "t");
+                fprintf(f,
+                        "%s{\"name\":\"frame\",\"cat\":\"%s\",\"ph\":\"%s\",\"bp\":\"e\",\"id\":%llu,\"pid\":1,"
+                        "\"tid\":%d,\"ts\":%lld}",
+                        separator, frameEvents[i]->group, phase, (unsigned long long)frame,
+                        tid(frameEvents[i]->worker), (long long)frameEvents[i]->startUs);
+            }
+        }
+        fprintf(f, "\n]}\n");
+        fclose(f);
+        return true;
+    }
+
+private:
+    // Trace viewers sort the tracks by tid, external threads go first.
+    static int tid(int worker) {
+        return worker + 1;
+    }
+
+    std::vector<Event> events;
+    std::atomic<size_t> recorded{0};
+    std::atomic<uint64_t> nextFrame{1};
+    const std::chrono::steady_clock::time_point epoch;
+};
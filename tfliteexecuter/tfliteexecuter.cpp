@@ -3,9 +3,14 @@
 #include <tflite_c_api.h>
 #include <tflite_c_api_xnnpack_delegate.h>
 
+#include <algorithm>
 #include <boost/filesystem.hpp>
+#include <cmath>
 #include <cstdio>
 #include <cstdlib>
+#include <emmintrin.h>
+#include <mutex>
+#include <thread>
 
 #define MY_ASSERT_NE(v, e)                                                                        \
     do {                                                                                          \
@@ -27,9 +32,121 @@
 
 namespace htwk {
 
+namespace {
+
+struct SharedDelegate {
+    TfLiteDelegate* delegate = nullptr;
+    int users = 0;
+    // Recent XNNPACK delegates give all their runtimes one workspace, so only one of them may run at a time.
+    std::atomic<bool> invoking{false};
+    std::function<void(const std::function<bool()>&)> wait;
+    std::function<void()> notify;
+};
+
+std::mutex sharedDelegateMtx;
+int sharedThreadPoolSize = 2;
+// The delegate with the shared threadpool.
+SharedDelegate sharedDelegate;
+
+TFLiteExecuter::Quantization getQuantization(const TfLiteTensor* tensor) {
+    TFLiteExecuter::Quantization quantization;
+    switch (TfLiteTensorType(tensor)) {
+    case kTfLiteFloat32:
+        return quantization;
+    case kTfLiteUInt8:
+        quantization.type = TFLiteExecuter::TensorType::UINT8;
+        break;
+    case kTfLiteInt8:
+        quantization.type = TFLiteExecuter::TensorType::INT8;
+        break;
+    default:
+        fprintf(stderr, "%s:%d - %s - Tensor %s has the unsupported type %d!\n", __FILE__, __LINE__,
+                __PRETTY_FUNCTION__, TfLiteTensorName(tensor), (int)TfLiteTensorType(tensor));
+        fflush(stderr);
+        exit(1);
+    }
+    TfLiteQuantizationParams params = TfLiteTensorQuantizationParams(tensor);
+    if (params.scale <= 0.f) {
+        fprintf(stderr, "%s:%d - %s - Tensor %s is not quantized per tensor!\n", __FILE__, __LINE__,
+                __PRETTY_FUNCTION__, TfLiteTensorName(tensor));
+        fflush(stderr);
+        exit(1);
+    }
+    quantization.scale = params.scale;
+    quantization.zeroPoint = params.zero_point;
+    return quantization;
+}
+
+size_t elementSize(const TFLiteExecuter::Quantization& quantization) {
+    return quantization.type == TFLiteExecuter::TensorType::FLOAT32 ? sizeof(float) : sizeof(uint8_t);
+}
+
+}  // namespace
+
 TFLiteExecuter::~TFLiteExecuter() {
     TfLiteInterpreterDelete(interpreter);
-    TfLiteXNNPackDelegateDelete(delegate);
+    if (delegate != nullptr)
+        releaseDelegate();
+}
+
+void TFLiteExecuter::setSharedThreadPoolSize(int numThreads) {
+    std::lock_guard<std::mutex> lck(sharedDelegateMtx);
+    if (sharedDelegate.delegate != nullptr && numThreads != sharedThreadPoolSize) {
+        fprintf(stderr, "%s:%d - %s - The shared threadpool is already in use with %d threads, ignoring %d.\n",
+                __FILE__, __LINE__, __PRETTY_FUNCTION__, sharedThreadPoolSize, numThreads);
+        return;
+    }
+    sharedThreadPoolSize = numThreads;
+}
+
+int TFLiteExecuter::getSharedThreadPoolSize() {
+    std::lock_guard<std::mutex> lck(sharedDelegateMtx);
+    return sharedThreadPoolSize;
+}
+
+void TFLiteExecuter::setSharedDelegateWaiter(std::function<void(const std::function<bool()>&)> wait,
+                                             std::function<void()> notify) {
+    std::lock_guard<std::mutex> lck(sharedDelegateMtx);
+    sharedDelegate.wait = std::move(wait);
+    sharedDelegate.notify = std::move(notify);
+}
+
+// Single threaded executers get their own delegate and run independently of each other. The multi threaded ones
+// share one delegate and its threadpool, execute() serializes their invocations.
+void TFLiteExecuter::acquireDelegate(int numThreads) {
+    std::lock_guard<std::mutex> lck(sharedDelegateMtx);
+    if (numThreads <= 1 || sharedThreadPoolSize <= 1) {
+        TfLiteXNNPackDelegateOptions xnnPackDelegateOption = TfLiteXNNPackDelegateOptionsDefault();
+        xnnPackDelegateOption.num_threads = 1;
+        delegate = TfLiteXNNPackDelegateCreate(&xnnPackDelegateOption);
+        MY_ASSERT_NE(delegate, nullptr);
+        invoking = nullptr;
+        return;
+    }
+    if (sharedDelegate.delegate == nullptr) {
+        TfLiteXNNPackDelegateOptions xnnPackDelegateOption = TfLiteXNNPackDelegateOptionsDefault();
+        xnnPackDelegateOption.num_threads = sharedThreadPoolSize;
+        sharedDelegate.delegate = TfLiteXNNPackDelegateCreate(&xnnPackDelegateOption);
+        MY_ASSERT_NE(sharedDelegate.delegate, nullptr);
+    }
+    sharedDelegate.users++;
+    delegate = sharedDelegate.delegate;
+    invoking = &sharedDelegate.invoking;
+}
+
+void TFLiteExecuter::releaseDelegate() {
+    if (invoking == nullptr) {
+        TfLiteXNNPackDelegateDelete(delegate);
+        delegate = nullptr;
+        return;
+    }
+    std::lock_guard<std::mutex> lck(sharedDelegateMtx);
+    if (--sharedDelegate.users == 0) {
+        TfLiteXNNPackDelegateDelete(sharedDelegate.delegate);
+        sharedDelegate.delegate = nullptr;
+    }
+    delegate = nullptr;
+    invoking = nullptr;
 }
 
 static void error_reporter(void* user_data, const char* format, va_list args) {
@@ -47,51 +164,23 @@ void TFLiteExecuter::loadModelFromFile(std::string file, std::vector<int> inputD
         fflush(stderr);
         exit(1);
     }
-
-    TfLiteXNNPackDelegateOptions xnnPackDelegateOption = TfLiteXNNPackDelegateOptionsDefault();
-    xnnPackDelegateOption.num_threads = numThreads;
-    delegate = TfLiteXNNPackDelegateCreate(&xnnPackDelegateOption);
-    MY_ASSERT_NE(delegate, nullptr);
-
-    TfLiteInterpreterOptions* options = TfLiteInterpreterOptionsCreate();
-    MY_ASSERT_NE(options, nullptr);
-    TfLiteInterpreterOptionsSetNumThreads(options, numThreads);
-    TfLiteInterpreterOptionsAddDelegate(options, delegate);
-
-    interpreter = TfLiteInterpreterCreate(model, options);
-    MY_ASSERT_NE(interpreter, nullptr);
-
-    TfLiteInterpreterOptionsDelete(options);
-    TfLiteModelDelete(model);
-
-    MY_ASSERT_EQ(TfLiteInterpreterAllocateTensors(interpreter), kTfLiteOk);
-    MY_ASSERT_EQ(TfLiteInterpreterGetInputTensorCount(interpreter), 1);
-    MY_ASSERT_EQ(TfLiteInterpreterGetOutputTensorCount(interpreter), 1);
-
-    MY_ASSERT_EQ(TfLiteInterpreterResizeInputTensor(interpreter, 0, inputDims.data(), inputDims.size()), kTfLiteOk);
-    MY_ASSERT_EQ(TfLiteInterpreterAllocateTensors(interpreter), kTfLiteOk);
-
-    TfLiteTensor* inputTensor = TfLiteInterpreterGetInputTensor(interpreter, 0);
-    MY_ASSERT_NE(inputTensor, nullptr);
-    MY_ASSERT_EQ(TfLiteTensorType(inputTensor), kTfLiteFloat32);
-
-    const TfLiteTensor* outputTensor = TfLiteInterpreterGetOutputTensor(interpreter, 0);
-    MY_ASSERT_NE(outputTensor, nullptr);
-    MY_ASSERT_EQ(TfLiteTensorType(outputTensor), kTfLiteFloat32);
+    createInterpreter(model, inputDims, numThreads);
 }
 
 void TFLiteExecuter::loadModelFromArray(const void* modelData, size_t length, std::vector<int> inputDims,
                                         int numThreads) {
     TfLiteModel* model = TfLiteModelCreate(modelData, length);
     MY_ASSERT_NE(model, nullptr);
+    createInterpreter(model, inputDims, numThreads);
+}
 
-    TfLiteXNNPackDelegateOptions xnnPackDelegateOption = TfLiteXNNPackDelegateOptionsDefault();
-    delegate = TfLiteXNNPackDelegateCreate(&xnnPackDelegateOption);
-    MY_ASSERT_NE(delegate, nullptr);
+void TFLiteExecuter::createInterpreter(TfLiteModel* model, std::vector<int>& inputDims, int numThreads) {
+    acquireDelegate(numThreads);
 
     TfLiteInterpreterOptions* options = TfLiteInterpreterOptionsCreate();
     MY_ASSERT_NE(options, nullptr);
-    TfLiteInterpreterOptionsSetNumThreads(options, numThreads);
+    // Operations that XNNPACK doesn't support stay on the calling thread instead of getting their own threads.
+    TfLiteInterpreterOptionsSetNumThreads(options, 1);
     TfLiteInterpreterOptionsAddDelegate(options, delegate);
 
     interpreter = TfLiteInterpreterCreate(model, options);
@@ -109,31 +198,106 @@ void TFLiteExecuter::loadModelFromArray(const void* modelData, size_t length, st
 
     TfLiteTensor* inputTensor = TfLiteInterpreterGetInputTensor(interpreter, 0);
     MY_ASSERT_NE(inputTensor, nullptr);
-    MY_ASSERT_EQ(TfLiteTensorType(inputTensor), kTfLiteFloat32);
+    inputQuantization = getQuantization(inputTensor);
 
     const TfLiteTensor* outputTensor = TfLiteInterpreterGetOutputTensor(interpreter, 0);
     MY_ASSERT_NE(outputTensor, nullptr);
-    MY_ASSERT_EQ(TfLiteTensorType(outputTensor), kTfLiteFloat32);
+    outputQuantization = getQuantization(outputTensor);
+
+    if (isInputQuantized())
+        floatInput.resize(getElementsInputTensor());
+    if (outputQuantization.type != TensorType::FLOAT32)
+        floatOutput.resize(getElementsOutputTensor());
 }
 
 float* TFLiteExecuter::getInputTensor() {
+    if (isInputQuantized()) {
+        quantizeFloatInput = true;
+        return floatInput.data();
+    }
     return TfLiteInterpreterGetInputTensor(interpreter, 0)->data.f;
 }
 
+uint8_t* TFLiteExecuter::getQuantizedInputTensor() {
+    MY_ASSERT_EQ(isInputQuantized(), true);
+    quantizeFloatInput = false;
+    return TfLiteInterpreterGetInputTensor(interpreter, 0)->data.uint8;
+}
+
 const float* TFLiteExecuter::getOutputTensor() {
+    if (outputQuantization.type != TensorType::FLOAT32)
+        return floatOutput.data();
     return TfLiteInterpreterGetOutputTensor(interpreter, 0)->data.f;
 }
 
 size_t TFLiteExecuter::getElementsInputTensor() {
-    return TfLiteTensorByteSize(TfLiteInterpreterGetInputTensor(interpreter, 0)) / sizeof(float);
+    return TfLiteTensorByteSize(TfLiteInterpreterGetInputTensor(interpreter, 0)) / elementSize(inputQuantization);
 }
 
 size_t TFLiteExecuter::getElementsOutputTensor() {
-    return TfLiteTensorByteSize(TfLiteInterpreterGetOutputTensor(interpreter, 0)) / sizeof(float);
+    return TfLiteTensorByteSize(TfLiteInterpreterGetOutputTensor(interpreter, 0)) / elementSize(outputQuantization);
 }
 
 void TFLiteExecuter::execute() {
-    MY_ASSERT_EQ(TfLiteInterpreterInvoke(interpreter), kTfLiteOk);
+    if (quantizeFloatInput)
+        quantize(floatInput.data(), TfLiteInterpreterGetInputTensor(interpreter, 0)->data.uint8, floatInput.size(),
+                 inputQuantization);
+    if (invoking != nullptr) {
+        auto tryAcquire = [this]() {
+            bool expected = false;
+            return invoking->compare_exchange_strong(expected, true, std::memory_order_acquire);
+        };
+        auto isFree = [this]() { return !invoking->load(std::memory_order_relaxed); };
+        while (!tryAcquire()) {
+            if (sharedDelegate.wait)
+                sharedDelegate.wait(isFree);
+            else
+                std::this_thread::yield();
+        }
+        MY_ASSERT_EQ(TfLiteInterpreterInvoke(interpreter), kTfLiteOk);
+        invoking->store(false, std::memory_order_release);
+        if (sharedDelegate.notify)
+            sharedDelegate.notify();
+    } else {
+        MY_ASSERT_EQ(TfLiteInterpreterInvoke(interpreter), kTfLiteOk);
+    }
+    if (outputQuantization.type != TensorType::FLOAT32)
+        dequantize(TfLiteInterpreterGetOutputTensor(interpreter, 0)->data.uint8, floatOutput.data(),
+                   floatOutput.size(), outputQuantization);
+}
+
+void TFLiteExecuter::quantize(const float* src, uint8_t* dest, size_t count, const Quantization& quantization) {
+    const bool isSigned = quantization.type == TensorType::INT8;
+    const float invScale = 1.f / quantization.scale;
+    size_t i = 0;
+    // _mm_cvtps_epi32 rounds to nearest even like lrintf and the packs saturate.
+    const __m128 vInvScale = _mm_set1_ps(invScale);
+    const __m128i vZeroPoint = _mm_set1_epi32(quantization.zeroPoint);
+    for (; i + 16 <= count; i += 16) {
+        __m128i q[4];
+        for (int j = 0; j < 4; j++)
+            q[j] = _mm_add_epi32(_mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(src + i + 4 * j), vInvScale)), vZeroPoint);
+        const __m128i lo = _mm_packs_epi32(q[0], q[1]);
+        const __m128i hi = _mm_packs_epi32(q[2], q[3]);
+        _mm_storeu_si128((__m128i*)(dest + i), isSigned ? _mm_packs_epi16(lo, hi) : _mm_packus_epi16(lo, hi));
+    }
+    const long minValue = isSigned ? -128 : 0;
+    const long maxValue = isSigned ? 127 : 255;
+    for (; i < count; i++) {
+        const long q = std::min(std::max(std::lrint(src[i] * invScale) + quantization.zeroPoint, minValue), maxValue);
+        dest[i] = (uint8_t)q;
+    }
+}
+
+void TFLiteExecuter::dequantize(const uint8_t* src, float* dest, size_t count, const Quantization& quantization) {
+    if (quantization.type == TensorType::INT8) {
+        const int8_t* values = (const int8_t*)src;
+        for (size_t i = 0; i < count; i++)
+            dest[i] = quantization.scale * (values[i] - quantization.zeroPoint);
+    } else {
+        for (size_t i = 0; i < count; i++)
+            dest[i] = quantization.scale * (src[i] - quantization.zeroPoint);
+    }
 }
 
 std::string TFLiteExecuter::getTFliteModelPath() {
@@ -1,12 +1,15 @@
 #ifndef TFLITEEXECUTER_H
 #define TFLITEEXECUTER_H
 
+#include <atomic>
 #include <cstdint>
+#include <functional>
 #include <string>
 #include <vector>
 
 struct TfLiteInterpreter;
 struct TfLiteDelegate;
+struct TfLiteModel;
 
 namespace htwk {
 
@@ -21,12 +24,30 @@ public:
     TFLiteExecuter& operator=(const TFLiteExecuter&) = delete;
     TFLiteExecuter& operator=(TFLiteExecuter&&) = delete;
 
+    enum class TensorType { FLOAT32, UINT8, INT8 };
+    // A quantized value q stands for scale * (q - zeroPoint).
+    struct Quantization {
+        TensorType type = TensorType::FLOAT32;
+        float scale = 1.f;
+        int32_t zeroPoint = 0;
+    };
+
     void loadModelFromFile(std::string file, std::vector<int> inputDims, int numThreads = 1);
     void loadModelFromArray(const void* modelData, size_t length, std::vector<int> inputDims, int numThreads = 1);
 
+    // For a quantized model this is a float buffer that execute() quantizes, so every consumer works with both kinds
+    // of models. Consumers that can produce the quantized values themselves write to getQuantizedInputTensor()
+    // instead, the last of the two that was called decides which one is used.
     float* getInputTensor();
+    // The uint8 or int8 values of a quantized input tensor.
+    uint8_t* getQuantizedInputTensor();
+    // Dequantized if the model has a quantized output.
     const float *getOutputTensor();
 
+    const Quantization& getInputQuantization() const { return inputQuantization; }
+    const Quantization& getOutputQuantization() const { return outputQuantization; }
+    bool isInputQuantized() const { return inputQuantization.type != TensorType::FLOAT32; }
+
     size_t getElementsInputTensor();
     size_t getElementsOutputTensor();
 
@@ -35,9 +56,38 @@ public:
 
     static std::string getTFliteModelPath();
 
+    // Rounds to nearest and saturates like TFLite.
+    static void quantize(const float* src, uint8_t* dest, size_t count, const Quantization& quantization);
+    static void dequantize(const uint8_t* src, float* dest, size_t count, const Quantization& quantization);
+
+    // Executers that ask for more than one thread run on one XNNPACK delegate with a threadpool of this size instead
+    // of one threadpool each, so together they never use more threads than that. Their invocations are serialized.
+    // Single threaded executers keep their own delegate and run on the calling thread only. The XNNPACK threadpool
+    // is separate from any ThreadPool of the caller. Set it before the first model is loaded.
+    static void setSharedThreadPoolSize(int numThreads);
+    static int getSharedThreadPoolSize();
+
+    // An executer that has to wait for the multi threaded delegate calls wait(ready) instead of blocking, e.g. with
+    // ThreadPool::waitUntil() so the thread helps with other jobs in the meantime. notify() is called every time the
+    // delegate becomes free. Without them the executer spins and yields. Set them before the first execute().
+    static void setSharedDelegateWaiter(std::function<void(const std::function<bool()>&)> wait,
+                                        std::function<void()> notify);
+
 private:
     TfLiteInterpreter* interpreter = nullptr;
     TfLiteDelegate* delegate = nullptr;
+    // Set if the delegate is the shared one, true while one of its executers invokes.
+    std::atomic<bool>* invoking = nullptr;
+
+    Quantization inputQuantization;
+    Quantization outputQuantization;
+    std::vector<float> floatInput;
+    std::vector<float> floatOutput;
+    bool quantizeFloatInput = false;
+
+    void createInterpreter(TfLiteModel* model, std::vector<int>& inputDims, int numThreads);
+    void acquireDelegate(int numThreads);
+    void releaseDelegate();
 };
 
 }
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+
+// Hands the latest value of one writer to any number of readers without locks. The writer fills a slot that is
+// neither the latest one nor being read and then publishes it. Readers pin the latest slot while they copy it out, so
+// a slow reader never sees a half written value and never blocks the writer for longer than its copy takes. If T
+// doesn't allocate, neither side does.
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() = default;
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer(TripleBuffer&&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(TripleBuffer&&) = delete;
+
+    // Only one thread at a time may write. The returned slot contains an old value.
+    T& beginWrite() {
+        const int latestSlot = latest.load(std::memory_order_relaxed);
+        while (true) {
+            for (int i = 0; i < numSlots; i++) {
+                int unpinned = 0;
+                if (i != latestSlot &&
+                    pins[i].compare_exchange_strong(unpinned, writing, std::memory_order_acquire,
+                                                    std::memory_order_relaxed)) {
+                    writeSlot = i;
+                    return slots[i];
+                }
+            }
+            // Both other slots are being copied by readers right now.
+            std::this_thread::yield();
+        }
+    }
+
+    void publish() {
+        latest.store(writeSlot, std::memory_order_release);
+        pins[writeSlot].store(0, std::memory_order_release);
+    }
+
+    // Returns a default constructed T until the first publish().
+    T read() const {
+        while (true) {
+            const int slot = latest.load(std::memory_order_acquire);
+            int current = pins[slot].load(std::memory_order_relaxed);
+            while (current != writing && !pins[slot].compare_exchange_weak(current, current + 1,
+                                                                          std::memory_order_acquire,
+                                                                          std::memory_order_relaxed)) {
+            }
+            // The writer took the slot after it stopped being the latest one, there is a newer one.
+            if (current == writing)
+                continue;
+            T value = slots[slot];
+            pins[slot].fetch_sub(1, std::memory_order_release);
+            return value;
+        }
+    }
+
+private:
+    static constexpr int numSlots = 3;
+    static constexpr int writing = -1;
+
+    T slots[numSlots];
+    // Number of readers per slot, or writing.
+    mutable std::atomic<int> pins[numSlots] = {0, 0, 0};
+    std::atomic<int> latest{0};
+    int writeSlot = 0;
+};
@@ -21,7 +21,7 @@ UpperCamBallHypothesesGenerator::UpperCamBallHypothesesGenerator(int8_t *lutCb,
     , patchHeight(config.ucBallHypGeneratorConfig.patchHeight)
     , imageWidth(config.ucBallHypGeneratorConfig.scaledImageWidth)
     , imageHeight(config.ucBallHypGeneratorConfig.scaledImageHeight)
-    , thread_pool(thread_pool)
+    , hypGenGraph(thread_pool)
 {
     const auto& hypConf = config.ucBallHypGeneratorConfig;
 
@@ -30,6 +30,10 @@ UpperCamBallHypothesesGenerator::UpperCamBallHypothesesGenerator(int8_t *lutCb,
             hypGenExecuter[i].loadModelFromFile(config.tflitePath + "/" + hypConf.model,
                                              {hypConf.hypothesisCount / num_threads, patchHeight, patchWidth, channels}, 1);
             inputHypFinder[i] = hypGenExecuter[i].getInputTensor();
+            hypGenGraph.addTask([i, this] {
+                EASY_FUNCTION();
+                hypGenExecuter[i].execute();
+            }, {});
         }
     } else {
         size_t alloc_size = num_threads * patchWidth * patchHeight * channels;
@@ -53,51 +57,31 @@ UpperCamBallHypothesesGenerator::~UpperCamBallHypothesesGenerator() {
     }
 }
 
+ImagePreprocessor::TiledSink UpperCamBallHypothesesGenerator::getTiledSink() const {
+    // One batch per row of patches.
+    ImagePreprocessor::TiledSink sink{patchWidth, patchHeight, {}};
+    for (int py = 0; py < imageHeight / patchHeight; py++)
+        sink.patchRows.push_back(inputHypFinder[py]);
+    return sink;
+}
+
 void UpperCamBallHypothesesGenerator::proceed(CamPose& cam_pose, std::shared_ptr<ImagePreprocessor> imagePreprocessor) {
     Timer t("UpperCamBallHypothesesGenerator", 50);
     EASY_FUNCTION();
     const int patches_y = imageHeight / patchHeight;
     const int patches_x = imageWidth / patchWidth;
 
-    const float* img = imagePreprocessor->getScaledImage().data();
-
-    EASY_BLOCK("UpperCamBallHypothesesGenerator Prepare");
-    for (int py = 0; py < patches_y; py++) {
-        float* input = inputHypFinder[py];
-        for (int px = 0; px < patches_x; px++) {
-            float* output = input + px * (patchWidth * patchHeight * 3);
-
-            int iy = py * patchHeight * (patches_x * patchWidth * 3);
-            int ix = px * (patchWidth * 3);
-
-            // printf("y: %d, x: %d = %d\n", py, px, (py * patches_x + px) * (patchWidth * patchHeight * 3));
-            for (int y = 0; y < patchHeight; y++) {
-                for (int x = 0; x < patchWidth; x++) {
-                    output[0 + x * 3 + y * (3 * patchWidth)] = img[0 + (ix + x * 3) + (iy + y * (3 * patchWidth * patches_x))];
-                    output[1 + x * 3 + y * (3 * patchWidth)] = img[1 + (ix + x * 3) + (iy + y * (3 * patchWidth * patches_x))];
-                    output[2 + x * 3 + y * (3 * patchWidth)] = img[2 + (ix + x * 3) + (iy + y * (3 * patchWidth * patches_x))];
-                    // printf("pyx(%d, %d), yx(%d, %d), Y%0.2f, o(%d), i(%d)\n", py, px, y, x, output[0 + x * 3 + y * (3
-                    // * patchWidth)], 0 + x * 3 + y * (3 * patchWidth), (ix + x * 3) + (iy + y * (3 * patchWidth *
-                    // patches_x)));
-                }
-            }
-        }
+    if (!imagePreprocessor->hasTiledSink(inputHypFinder[0])) {
+        EASY_BLOCK("UpperCamBallHypothesesGenerator Prepare");
+        imagePreprocessor->writeTiled(getTiledSink());
+        EASY_END_BLOCK;
     }
-    EASY_END_BLOCK;
 
     if (!config.ucBallHypGeneratorConfig.classifyHypData)
         return;
 
     EASY_BLOCK("UpperCamBallHypothesesGenerator Hyp");
-    TaskScheduler scheduler(thread_pool);
-
-    for(int i = 0; i < num_threads; i++) {
-        scheduler.addTask([i, this] {
-            EASY_FUNCTION();
-            hypGenExecuter[i].execute();
-        }, {});
-    }
-    scheduler.run();
+    hypGenGraph.run();
     EASY_END_BLOCK;
 
     hypotheses.clear();
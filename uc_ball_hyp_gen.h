@@ -36,6 +36,9 @@ public:
 
     void drawPatch(uint8_t* yuvImage, int px, int py);
 
+    // Where the patches of the scaled image go, see ImagePreprocessor::addTiledSink.
+    ImagePreprocessor::TiledSink getTiledSink() const;
+
 private:
     static constexpr int channels = 3;
     static constexpr int num_threads = 4;
@@ -43,7 +46,7 @@ private:
     std::vector<ObjectHypothesis> hypotheses;
     float* inputHypFinder[num_threads];
     TFLiteExecuter hypGenExecuter[num_threads];
-    ThreadPool* thread_pool;
+    TaskGraph hypGenGraph;
 
     constexpr float scale(float x, float from_min, float from_max, float to_min, float to_max) {
         return ((to_max - to_min) * (x - from_min)) / (from_max - from_min) + to_min;
@@ -44,36 +44,21 @@ UpperCamCenterCirclePointDetector::~UpperCamCenterCirclePointDetector() {
     }
 }
 
+ImagePreprocessor::TiledSink UpperCamCenterCirclePointDetector::getTiledSink() const {
+    ImagePreprocessor::TiledSink sink{patchWidth, patchHeight, {}};
+    for (int py = 0; py < patchesY; py++)
+        sink.patchRows.push_back(inputDetector + py * patchesX * (patchWidth * patchHeight * channels));
+    return sink;
+}
+
 void UpperCamCenterCirclePointDetector::proceed(CamPose& cam_pose, std::shared_ptr<ImagePreprocessor> imagePreprocessor) {
     Timer t("UpperCamCenterCirclePointDetector", 50);
     EASY_FUNCTION();
-    const float* img = imagePreprocessor->getScaledImage().data();
-
-    EASY_BLOCK("UpperCamCenterCirclePointDetector Prepare");
-    for (int py = 0; py < patchesY; py++) {
-        for (int px = 0; px < patchesX; px++) {
-            float* output = inputDetector + (py * patchesX + px) * (patchWidth * patchHeight * 3);
-
-            int iy = py * patchHeight * (patchesX * patchWidth * 3);
-            int ix = px * (patchWidth * 3);
-
-            // printf("y: %d, x: %d = %d\n", py, px, (py * patches_x + px) * (patchWidth * patchHeight * 3));
-            for (int y = 0; y < patchHeight; y++) {
-                for (int x = 0; x < patchWidth; x++) {
-                    output[0 + x * 3 + y * (3 * patchWidth)] =
-                            img[0 + (ix + x * 3) + (iy + y * (3 * patchWidth * patchesX))];
-                    output[1 + x * 3 + y * (3 * patchWidth)] =
-                            img[1 + (ix + x * 3) + (iy + y * (3 * patchWidth * patchesX))];
-                    output[2 + x * 3 + y * (3 * patchWidth)] =
-                            img[2 + (ix + x * 3) + (iy + y * (3 * patchWidth * patchesX))];
-                    // printf("pyx(%d, %d), yx(%d, %d), Y%0.2f, o(%d), i(%d)\n", py, px, y, x, output[0 + x * 3 + y * (3
-                    // * patchWidth)], 0 + x * 3 + y * (3 * patchWidth), (ix + x * 3) + (iy + y * (3 * patchWidth *
-                    // patches_x)));
-                }
-            }
-        }
+    if (!imagePreprocessor->hasTiledSink(inputDetector)) {
+        EASY_BLOCK("UpperCamCenterCirclePointDetector Prepare");
+        imagePreprocessor->writeTiled(getTiledSink());
+        EASY_END_BLOCK;
     }
-    EASY_END_BLOCK;
 
     if (!config.ucCenterCirclePointDetectorConfig.runDetector)
         return;
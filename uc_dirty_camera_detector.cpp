@@ -36,7 +36,8 @@ UpperCamDirtyCameraDetector::UpperCamDirtyCameraDetector(int8_t *lutCb, int8_t *
 
 UpperCamDirtyCameraDetector::~UpperCamDirtyCameraDetector() {}
 
-void UpperCamDirtyCameraDetector::proceed(const uint8_t *img, std::shared_ptr<ImagePreprocessor> imagePreprocessor) {
+void UpperCamDirtyCameraDetector::proceed(const uint8_t *img, std::shared_ptr<ImagePreprocessor> imagePreprocessor,
+                                          const GreenMask *greenMask) {
     Timer t("UpperCamDirtyCameraDetector", 150);
     EASY_FUNCTION();
 
@@ -47,10 +48,15 @@ void UpperCamDirtyCameraDetector::proceed(const uint8_t *img, std::shared_ptr<Im
 
     int testedPixelCount = 0;
     int greenPixelCount = 0;
-    for (int y = config.height / 4; y < config.height; y += config.height / 10) {
-        for (int x = 32; x < config.width - 32; x += config.width / 10) {
-            testedPixelCount++;
-            greenPixelCount += fieldColorDetector->isGreen(img, x, y) ? 1 : 0;
+    if (greenMask) {
+        testedPixelCount = greenMask->countPixels(32, config.height / 4, config.width - 32, config.height);
+        greenPixelCount = greenMask->countGreen(32, config.height / 4, config.width - 32, config.height);
+    } else {
+        for (int y = config.height / 4; y < config.height; y += config.height / 10) {
+            for (int x = 32; x < config.width - 32; x += config.width / 10) {
+                testedPixelCount++;
+                greenPixelCount += fieldColorDetector->isGreen(img, x, y) ? 1 : 0;
+            }
         }
     }
 
@@ -60,8 +66,9 @@ void UpperCamDirtyCameraDetector::proceed(const uint8_t *img, std::shared_ptr<Im
 
     wasExecutedFlag = true;
     EASY_BLOCK("UpperCamDirtyCameraDetector Prepare");
-    std::memcpy(input, imagePreprocessor->getScaledImage().data(),
-                imagePreprocessor->getScaledImage().size() * sizeof(float));
+    if (!imagePreprocessor->hasTensorSink(input))
+        std::memcpy(input, imagePreprocessor->getScaledImage().data(),
+                    imagePreprocessor->getScaledImage().size() * sizeof(float));
     EASY_END_BLOCK;
 
     EASY_BLOCK("UpperCamDirtyCameraDetector Hyp");
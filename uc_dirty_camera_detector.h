@@ -5,6 +5,7 @@
 #include <image_preprocessor.h>
 #include <tfliteexecuter.h>
 #include <field_color_detector.h>
+#include <green_mask.h>
 
 #include <memory>
 #include <vector>
@@ -24,7 +25,9 @@ public:
     UpperCamDirtyCameraDetector& operator=(UpperCamDirtyCameraDetector&&) = delete;
     ~UpperCamDirtyCameraDetector();
 
-    void proceed(const uint8_t* img, std::shared_ptr<ImagePreprocessor> imagePreprocessor);
+    // With a greenMask it counts all green pixels in the gate area instead of testing a sparse grid.
+    void proceed(const uint8_t* img, std::shared_ptr<ImagePreprocessor> imagePreprocessor,
+                 const GreenMask* greenMask = nullptr);
     bool isCameraDirty() {
         return isCameraDirtyFlag;
     }
@@ -35,6 +38,11 @@ public:
 
     void shouldRun(bool state);
 
+    // The ImagePreprocessor can write straight into this, see ImagePreprocessor::addTensorSink().
+    float* getInputTensor() const {
+        return input;
+    }
+
 private:
     static constexpr int channels = 3;
     bool isCameraDirtyFlag = false;
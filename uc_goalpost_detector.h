@@ -24,12 +24,15 @@ public:
 
     void proceed(CamPose& cam_pose, std::shared_ptr<ImagePreprocessor> imagePreprocessor);
 
-    std::vector<ObjectHypothesis> getHypotheses() const {
+    const std::vector<ObjectHypothesis>& getHypotheses() const {
         return hypotheses;
     }
 
     void drawPatch(uint8_t* yuvImage, int px, int py);
 
+    // Where the patches of the scaled image go, see ImagePreprocessor::addTiledSink.
+    ImagePreprocessor::TiledSink getTiledSink() const;
+
 private:
     static constexpr int channels = 3;
 
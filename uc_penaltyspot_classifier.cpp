@@ -18,7 +18,7 @@ UpperCamPenaltySpotClassifier::UpperCamPenaltySpotClassifier(int8_t* lutCb, int8
 /*
  * detects the ball (if visible) and outputs its position
  */
-void UpperCamPenaltySpotClassifier::proceed(const uint8_t* img, const std::vector<ObjectHypothesis>& hypoList) {
+void UpperCamPenaltySpotClassifier::proceed(const PlanarImage& img, const std::vector<ObjectHypothesis>& hypoList) {
     Timer t("ObjectDetector", 50);
     EASY_FUNCTION(profiler::colors::Green);
 
@@ -9,6 +9,7 @@
 #include "base_detector.h"
 #include "htwk_vision_config.h"
 #include "object_hypothesis.h"
+#include "planar_image.h"
 #include "tfliteexecuter.h"
 
 namespace htwk {
@@ -22,7 +23,7 @@ public:
                    HtwkVisionConfig& config) __attribute__((nonnull));
     ~UpperCamPenaltySpotClassifier() = default;
 
-    void proceed(const uint8_t* img, const std::vector<ObjectHypothesis>& hypoList);
+    void proceed(const PlanarImage& img, const std::vector<ObjectHypothesis>& hypoList);
 
     std::optional<ObjectHypothesis> getPenaltySpot() const {
         return penaltySpotHypotheses;
@@ -15,9 +15,12 @@ UpperCamRobotDetector::UpperCamRobotDetector(int8_t* lutCb, int8_t* lutCr, HtwkV
     : BaseDetector(lutCb, lutCr, config) {
 
     tflite.loadModelFromFile(config.tflitePath + "/uc-robot-detector.tflite", {1, input_height, input_width, channels});
-    input = tflite.getInputTensor();
-
-    memset(input, 0, input_width * input_height * channels);
+    if (tflite.isInputQuantized()) {
+        quantizedInput = tflite.getQuantizedInputTensor();
+    } else {
+        input = tflite.getInputTensor();
+        memset(input, 0, input_width * input_height * channels);
+    }
 }
 
 UpperCamRobotDetector::~UpperCamRobotDetector() {}
@@ -28,7 +31,13 @@ void UpperCamRobotDetector::proceed(std::shared_ptr<ImagePreprocessor> imagePrep
     bounding_boxes.clear();
     bounding_boxes_after_nms.clear();
 
-    memcpy(input, imagePreprocessor->getScaledImage().data(), sizeof(*input) * channels * input_width * input_height);
+    if (quantizedInput != nullptr) {
+        if (!imagePreprocessor->hasQuantizedSink(quantizedInput))
+            imagePreprocessor->writeQuantized(quantizedInput, tflite.getInputQuantization());
+    } else {
+        memcpy(input, imagePreprocessor->getScaledImage().data(),
+               sizeof(*input) * channels * input_width * input_height);
+    }
 
     EASY_BLOCK("TFLite SSD");
     tflite.execute();
@@ -98,6 +107,15 @@ void UpperCamRobotDetector::drawInputParameter(uint8_t* yuvImage) {
     const int blockSizeWidth = width / input_width;
     const int blockSizeHeight = height / input_height;
 
+    std::vector<float> dequantized;
+    const float* input = this->input;
+    if (quantizedInput != nullptr) {
+        dequantized.resize(channels * input_width * input_height);
+        TFLiteExecuter::dequantize(quantizedInput, dequantized.data(), dequantized.size(),
+                                   tflite.getInputQuantization());
+        input = dequantized.data();
+    }
+
     for (int ySample = 0; ySample < input_height; ySample++) {
         const int startY = ySample * blockSizeHeight;
 
@@ -41,9 +41,18 @@ public:
 
     void drawInputParameter(uint8_t* yuvImage);
 
+    // Only set if the model has a quantized input.
+    uint8_t* getQuantizedInputTensor() const {
+        return quantizedInput;
+    }
+    const TFLiteExecuter::Quantization& getInputQuantization() const {
+        return tflite.getInputQuantization();
+    }
+
 private:
     TFLiteExecuter tflite;
     float* input = nullptr;
+    uint8_t* quantizedInput = nullptr;
 
     static constexpr int input_width = 80;
     static constexpr int input_height = 60;
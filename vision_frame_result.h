@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cam_constants.h>
+#include <cam_pose.h>
+#include <ellipse.h>
+#include <fixed_vector.h>
+#include <line.h>
+#include <linecross.h>
+#include <object_hypothesis.h>
+#include <uc_robot_detector.h>
+
+#include <cstdint>
+#include <optional>
+
+namespace htwk {
+
+/**
+ * Everything HTWKVision found in one frame. The detectors are reused for the next frame as soon as possible, this is
+ * a copy that stays valid. It doesn't allocate, lists are cut off at their capacity. Results of detectors that didn't
+ * run for the frame (other camera, skipped, only localization) are empty.
+ */
+struct VisionFrameResult {
+    // Counts the frames of one HTWKVision, 0 means there was no frame yet.
+    uint64_t frameNumber = 0;
+    CamPose camPose;
+
+    std::optional<ObjectHypothesis> ball;
+    std::optional<ObjectHypothesis> penaltySpot;
+
+    FixedVector<int, cam_width> fieldBorder;
+    FixedVector<Line, 32> lines;
+    FixedVector<LineCross, 32> lineCrossings;
+    Ellipse ellipse;
+
+    FixedVector<ObjectHypothesis, 16> goalPosts;
+    FixedVector<ObjectHypothesis, 16> centerCirclePoints;
+    FixedVector<RobotBoundingBox, 16> robots;
+    FixedVector<float, 64> obstacles;
+
+    bool cameraDirty = false;
+    bool cameraScrambled = false;
+    // The image hardly changed since the previous frame.
+    bool cameraStuck = false;
+};
+
+}  // namespace htwk
@@ -0,0 +1,63 @@
+#include "vision_rig.h"
+
+#include <algorithm>
+
+#include <easy/profiler.h>
+
+namespace htwk {
+
+VisionRig::VisionRig(HtwkVisionConfig& upperConfig, HtwkVisionConfig& lowerConfig, ThreadPool* thread_pool)
+    : upper(std::make_unique<HTWKVision>(upperConfig, thread_pool)),
+      lower(std::make_unique<HTWKVision>(lowerConfig, thread_pool)) {
+    if (!upper->getHtwkVisionConfig().isUpperCam || lower->getHtwkVisionConfig().isUpperCam) {
+        fprintf(stderr, "%s:%d: %s: VisionRig needs an upper and a lower camera config!\n", __FILE__, __LINE__,
+                __func__);
+        exit(1);
+    }
+}
+
+void VisionRig::proceed(uint8_t* upperImg, CamPose& upperCamPose, uint8_t* lowerImg, CamPose& lowerCamPose,
+                        bool ultra_low_latency) {
+    EASY_FUNCTION(profiler::colors::Blue);
+    updatePriority();
+    upper->setUrgent(prioritized == CamID::UPPER);
+    lower->setUrgent(prioritized == CamID::LOWER);
+
+    // The prioritized camera starts first, so it also gets the idle workers first.
+    if (prioritized == CamID::UPPER && upperImg != nullptr)
+        upper->startProceed(upperImg, upperCamPose, ultra_low_latency);
+    if (lowerImg != nullptr)
+        lower->startProceed(lowerImg, lowerCamPose, ultra_low_latency);
+    if (prioritized == CamID::LOWER && upperImg != nullptr)
+        upper->startProceed(upperImg, upperCamPose, ultra_low_latency);
+
+    if (upperImg != nullptr) {
+        upper->waitForProceed();
+        updateStats(upperStats, *upper);
+    }
+    if (lowerImg != nullptr) {
+        lower->waitForProceed();
+        updateStats(lowerStats, *lower);
+    }
+}
+
+// A ball in the lower camera is close, that one wins. If nobody sees the ball, the last decision stays. Uses the
+// published results, the detectors may already work on the next frame.
+void VisionRig::updatePriority() {
+    if (lower->getLatestResult().ball)
+        prioritized = CamID::LOWER;
+    else if (upper->getLatestResult().ball)
+        prioritized = CamID::UPPER;
+}
+
+void VisionRig::updateStats(CameraStats& stats, const HTWKVision& vision) {
+    stats.frames++;
+    stats.lastFrameMs = vision.getLastFrameTimeMs();
+    stats.worstFrameMs = std::max(stats.worstFrameMs, stats.lastFrameMs);
+    const HtwkVisionConfig& config = vision.getHtwkVisionConfig();
+    const float deadlineMs = config.frameDeadlineMs > 0.f ? config.frameDeadlineMs : config.robotFrameDeadlineMs;
+    if (stats.lastFrameMs > deadlineMs)
+        stats.deadlineMisses++;
+}
+
+}  // namespace htwk
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <async.h>
+#include <cam_constants.h>
+#include <cam_pose.h>
+#include <htwk_vision.h>
+#include <htwk_vision_config.h>
+
+#include <cstdint>
+#include <memory>
+
+namespace htwk {
+
+/**
+ * Runs the vision of the upper and the lower camera together on one ThreadPool. Both frames are in flight at the same
+ * time and the tasks of the camera that saw the ball last go ahead of the other one's. Frames that take longer than the
+ * frameDeadlineMs of their camera config (or robotFrameDeadlineMs if it is 0) are counted as deadline misses.
+ */
+class VisionRig {
+public:
+    struct CameraStats {
+        uint64_t frames = 0;
+        uint64_t deadlineMisses = 0;
+        float lastFrameMs = 0.f;
+        float worstFrameMs = 0.f;
+    };
+
+    std::unique_ptr<HTWKVision> upper;
+    std::unique_ptr<HTWKVision> lower;
+
+    VisionRig(HtwkVisionConfig& upperConfig, HtwkVisionConfig& lowerConfig, ThreadPool* thread_pool);
+    VisionRig(const VisionRig&) = delete;
+    VisionRig(VisionRig&&) = delete;
+    VisionRig& operator=(const VisionRig&) = delete;
+    VisionRig& operator=(VisionRig&&) = delete;
+    ~VisionRig() = default;
+
+    // Either image may be nullptr if there is no new frame of that camera.
+    void proceed(uint8_t* upperImg, CamPose& upperCamPose, uint8_t* lowerImg, CamPose& lowerCamPose,
+                 bool ultra_low_latency = false);
+
+    CamID getPrioritizedCamera() const {
+        return prioritized;
+    }
+    const CameraStats& getStats(CamID cam) const {
+        return cam == CamID::UPPER ? upperStats : lowerStats;
+    }
+
+private:
+    CamID prioritized = CamID::UPPER;
+    CameraStats upperStats;
+    CameraStats lowerStats;
+
+    void updatePriority();
+    static void updateStats(CameraStats& stats, const HTWKVision& vision);
+};
+
+}  // namespace htwk